@@ -71,6 +71,29 @@ maxMessageBuffer = 4
 emoteSpells = false
 classicEquipmentSlots = false
 
+-- Performance
+-- NOTE: tickReportInterval is in seconds and prints where the dispatcher
+-- spent its time (network, creatures, decay, lua, output) at that interval,
+-- set it to 0 to disable the report
+-- NOTE: slowTaskThreshold is in milliseconds, any dispatcher task running
+-- longer is logged and wait/execution times are profiled per task, the
+-- profile is printed with the tick report, set it to 0 to disable
+-- NOTE: parallelCreatureThink searches the follow paths of thinking monsters
+-- on creatureThinkThreads worker threads (0 = one less than the CPU count),
+-- results are only used while the map around the search is unchanged,
+-- the tick report shows the pool's stats
+-- NOTE: mapSnapshot keeps the decoded map next to the .otbm file (as .snapshot)
+-- and loads it instead while the map, items.otb and items.xml are unchanged
+-- NOTE: cleanMapInterval is in minutes, the tiles that received loose items
+-- since the last clean are swept a few milliseconds per dispatcher cycle
+-- instead of all at once, set it to 0 to disable
+tickReportInterval = 0
+slowTaskThreshold = 0
+parallelCreatureThink = false
+creatureThinkThreads = 0
+mapSnapshot = false
+cleanMapInterval = 0
+
 -- Rates
 -- NOTE: rateExp is not used if you have enabled stages in data/XML/stages.xml
 rateExp = 5
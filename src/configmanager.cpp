@@ -23,6 +23,7 @@
 
 #include "configmanager.h"
 #include "game.h"
+#include "tasks.h"
 
 #if LUA_VERSION_NUM >= 502
 #undef lua_strlen
@@ -30,6 +31,7 @@
 #endif
 
 extern Game g_game;
+extern Dispatcher g_dispatcher;
 
 namespace {
 
@@ -134,6 +136,8 @@ bool ConfigManager::load()
 	boolean[WARN_UNSAFE_SCRIPTS] = getGlobalBoolean(L, "warnUnsafeScripts", true);
 	boolean[CONVERT_UNSAFE_SCRIPTS] = getGlobalBoolean(L, "convertUnsafeScripts", true);
 	boolean[CLASSIC_EQUIPMENT_SLOTS] = getGlobalBoolean(L, "classicEquipmentSlots", false);
+	boolean[PARALLEL_CREATURE_THINK] = getGlobalBoolean(L, "parallelCreatureThink", false);
+	boolean[MAP_SNAPSHOT] = getGlobalBoolean(L, "mapSnapshot", false);
 
 	string[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
 	string[SERVER_NAME] = getGlobalString(L, "serverName", "");
@@ -170,6 +174,13 @@ bool ConfigManager::load()
 	integer[CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES] = getGlobalNumber(L, "checkExpiredMarketOffersEachMinutes", 60);
 	integer[MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER] = getGlobalNumber(L, "maxMarketOffersAtATimePerPlayer", 100);
 	integer[MAX_PACKETS_PER_SECOND] = getGlobalNumber(L, "maxPacketsPerSecond", 25);
+	integer[TICK_REPORT_INTERVAL] = getGlobalNumber(L, "tickReportInterval", 0);
+	integer[SLOW_TASK_THRESHOLD] = getGlobalNumber(L, "slowTaskThreshold", 0);
+	integer[CREATURE_THINK_THREADS] = getGlobalNumber(L, "creatureThinkThreads", 0);
+	integer[CLEAN_MAP_INTERVAL] = getGlobalNumber(L, "cleanMapInterval", 0);
+
+	// the dispatcher keeps its own copy, it only accounts the tick budget when asked to
+	g_dispatcher.setTickReporting(integer[TICK_REPORT_INTERVAL], integer[SLOW_TASK_THRESHOLD]);
 
 	loaded = true;
 	lua_close(L);
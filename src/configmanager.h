@@ -40,6 +40,8 @@ class ConfigManager
 			WARN_UNSAFE_SCRIPTS,
 			CONVERT_UNSAFE_SCRIPTS,
 			CLASSIC_EQUIPMENT_SLOTS,
+			PARALLEL_CREATURE_THINK,
+			MAP_SNAPSHOT,
 
 			LAST_BOOLEAN_CONFIG /* this must be the last one */
 		};
@@ -98,6 +100,10 @@ class ConfigManager
 			MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER,
 			EXP_FROM_PLAYERS_LEVEL_RANGE,
 			MAX_PACKETS_PER_SECOND,
+			TICK_REPORT_INTERVAL,
+			SLOW_TASK_THRESHOLD,
+			CREATURE_THINK_THREADS,
+			CLEAN_MAP_INTERVAL,
 
 			LAST_INTEGER_CONFIG /* this must be the last one */
 		};
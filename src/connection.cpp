@@ -74,7 +74,7 @@ void Connection::close(bool force)
 
 	if (protocol) {
 		g_dispatcher.addTask(
-			createTask(std::bind(&Protocol::release, protocol)));
+			createTask("Protocol::release", std::bind(&Protocol::release, protocol)));
 	}
 
 	if (messageQueue.empty() || force) {
@@ -107,7 +107,9 @@ Connection::~Connection()
 void Connection::accept(Protocol_ptr protocol)
 {
 	this->protocol = protocol;
-	g_dispatcher.addTask(createTask(std::bind(&Protocol::onConnect, protocol)));
+	Task* task = createTask("Protocol::onConnect", std::bind(&Protocol::onConnect, protocol));
+	task->setTickCategory(TICK_CATEGORY_NETWORK);
+	g_dispatcher.addTask(task);
 
 	accept();
 }
@@ -246,7 +248,17 @@ void Connection::send(const OutputMessage_ptr& msg)
 	bool noPendingWrite = messageQueue.empty();
 	messageQueue.emplace_back(msg);
 	if (noPendingWrite) {
-		internalSend(msg);
+		// padding, encryption and checksum run on the network thread, the caller only hands the message over
+		io_service.post(std::bind(&Connection::dispatchSend, shared_from_this()));
+	}
+}
+
+void Connection::dispatchSend()
+{
+	//network thread
+	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+	if (!messageQueue.empty()) {
+		internalSend(messageQueue.front());
 	}
 }
 
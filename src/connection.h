@@ -75,6 +75,7 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		Connection(boost::asio::io_service& io_service,
 		           ConstServicePort_ptr service_port) :
+			io_service(io_service),
 			readTimer(io_service),
 			writeTimer(io_service),
 			service_port(std::move(service_port)),
@@ -106,6 +107,7 @@ class Connection : public std::enable_shared_from_this<Connection>
 		static void handleTimeout(ConnectionWeak_ptr connectionWeak, const boost::system::error_code& error);
 
 		void closeSocket();
+		void dispatchSend();
 		void internalSend(const OutputMessage_ptr& msg);
 
 		boost::asio::ip::tcp::socket& getSocket() {
@@ -115,6 +117,7 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		NetworkMessage msg;
 
+		boost::asio::io_service& io_service;
 		boost::asio::deadline_timer readTimer;
 		boost::asio::deadline_timer writeTimer;
 
@@ -20,6 +20,7 @@
 #include "otpch.h"
 
 #include "creature.h"
+#include "creaturethink.h"
 #include "game.h"
 #include "monster.h"
 #include "configmanager.h"
@@ -33,6 +34,16 @@ extern Game g_game;
 extern ConfigManager g_config;
 extern CreatureEvents* g_creatureEvents;
 
+static void invalidatePathing(const Creature& creature, ConditionType_t type)
+{
+	// conditions decide field immunity and visibility while pathing, in-fight is
+	// refreshed on every hit and only matters through the pz lock, which is read
+	// by player searches alone and those are never searched ahead
+	if (type != CONDITION_INFIGHT) {
+		g_game.map.invalidatePathing(creature.getPosition());
+	}
+}
+
 Creature::Creature()
 {
 	onIdleStatus();
@@ -280,7 +291,7 @@ void Creature::addEventWalk(bool firstStep)
 		g_game.checkCreatureWalk(getID());
 	}
 
-	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, std::bind(&Game::checkCreatureWalk, &g_game, getID())));
+	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, "Game::checkCreatureWalk", std::bind(&Game::checkCreatureWalk, &g_game, getID())));
 }
 
 void Creature::stopEventWalk()
@@ -297,6 +308,7 @@ void Creature::updateMapCache()
 	const Position& myPos = getPosition();
 	Position pos(0, 0, myPos.z);
 
+	blockedFieldLayers = getBlockedFieldLayers();
 	for (int32_t y = -maxWalkCacheHeight; y <= maxWalkCacheHeight; ++y) {
 		for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
 			pos.x = myPos.getX() + x;
@@ -309,8 +321,76 @@ void Creature::updateMapCache()
 
 void Creature::updateTileCache(const Tile* tile, int32_t dx, int32_t dy)
 {
-	if (std::abs(dx) <= maxWalkCacheWidth && std::abs(dy) <= maxWalkCacheHeight) {
-		localMapCache[maxWalkCacheHeight + dy][maxWalkCacheWidth + dx] = tile && tile->queryAdd(0, *this, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) == RETURNVALUE_NOERROR;
+	if (std::abs(dx) > maxWalkCacheWidth || std::abs(dy) > maxWalkCacheHeight) {
+		return;
+	}
+
+	bool walkable = false;
+	int32_t fieldLayer = -1;
+	if (tile && !g_game.map.isPathBlocked(tile->getPosition())) {
+		uint32_t flags = FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE;
+
+		// fields with a layer of their own are applied by getBlockedFieldLayers instead
+		const MagicField* field = tile->getFieldItem();
+		if (field && !field->isBlocking()) {
+			const CombatType_t combatType = field->getCombatType();
+			for (int32_t i = 0; i < WALK_CACHE_FIELD_LAYERS; ++i) {
+				if (WALK_CACHE_FIELD_TYPES[i] == combatType) {
+					fieldLayer = i;
+					flags |= FLAG_IGNOREMAGICFIELD;
+					break;
+				}
+			}
+		}
+		walkable = tile->queryAdd(0, *this, 1, flags) == RETURNVALUE_NOERROR;
+	}
+
+	const int32_t y = maxWalkCacheHeight + dy;
+	const uint32_t bit = 1U << (maxWalkCacheWidth + dx);
+	for (int32_t layer = WALKCACHE_WALKABLE; layer < WALKCACHE_LAYERS; ++layer) {
+		walkCache[layer][y] &= ~bit;
+	}
+
+	if (fieldLayer >= 0) {
+		walkCache[WALKCACHE_FIELDS + fieldLayer][y] |= bit;
+	}
+
+	if (walkable) {
+		walkCache[WALKCACHE_BASE][y] |= bit;
+		if (fieldLayer < 0 || (blockedFieldLayers & (1 << fieldLayer)) == 0) {
+			walkCache[WALKCACHE_WALKABLE][y] |= bit;
+		}
+	}
+}
+
+uint8_t Creature::getBlockedFieldLayers() const
+{
+	uint8_t layers = 0;
+	for (int32_t i = 0; i < WALK_CACHE_FIELD_LAYERS; ++i) {
+		if (!canWalkOnField(WALK_CACHE_FIELD_TYPES[i])) {
+			layers |= 1 << i;
+		}
+	}
+	return layers;
+}
+
+void Creature::updateWalkCacheFields()
+{
+	const uint8_t layers = getBlockedFieldLayers();
+	if (layers == blockedFieldLayers) {
+		return;
+	}
+
+	// only which field layers are masked out changes, the tiles need no new queries
+	blockedFieldLayers = layers;
+	for (int32_t y = 0; y < mapWalkHeight; ++y) {
+		uint32_t avoided = 0;
+		for (int32_t i = 0; i < WALK_CACHE_FIELD_LAYERS; ++i) {
+			if (layers & (1 << i)) {
+				avoided |= walkCache[WALKCACHE_FIELDS + i][y];
+			}
+		}
+		walkCache[WALKCACHE_WALKABLE][y] = walkCache[WALKCACHE_BASE][y] & ~avoided;
 	}
 }
 
@@ -343,11 +423,7 @@ int32_t Creature::getWalkCache(const Position& pos) const
 	if (std::abs(dx) <= maxWalkCacheWidth) {
 		int32_t dy = Position::getOffsetY(pos, myPos);
 		if (std::abs(dy) <= maxWalkCacheHeight) {
-			if (localMapCache[maxWalkCacheHeight + dy][maxWalkCacheWidth + dx]) {
-				return 1;
-			} else {
-				return 0;
-			}
+			return (walkCache[WALKCACHE_WALKABLE][maxWalkCacheHeight + dy] >> (maxWalkCacheWidth + dx)) & 1;
 		}
 	}
 
@@ -495,8 +571,8 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 
 				if (oldPos.y > newPos.y) { //north
 					//shift y south
-					for (int32_t y = mapWalkHeight - 1; --y >= 0;) {
-						memcpy(localMapCache[y + 1], localMapCache[y], sizeof(localMapCache[y]));
+					for (auto& rows : walkCache) {
+						memmove(rows + 1, rows, sizeof(rows[0]) * (mapWalkHeight - 1));
 					}
 
 					//update 0
@@ -506,8 +582,8 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 					}
 				} else if (oldPos.y < newPos.y) { // south
 					//shift y north
-					for (int32_t y = 0; y <= mapWalkHeight - 2; ++y) {
-						memcpy(localMapCache[y], localMapCache[y + 1], sizeof(localMapCache[y]));
+					for (auto& rows : walkCache) {
+						memmove(rows, rows + 1, sizeof(rows[0]) * (mapWalkHeight - 1));
 					}
 
 					//update mapWalkHeight - 1
@@ -521,7 +597,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 					//shift y west
 					int32_t starty = 0;
 					int32_t endy = mapWalkHeight - 1;
-					int32_t dy = Position::getDistanceY(oldPos, newPos);
+					int32_t dy = Position::getOffsetY(oldPos, newPos);
 
 					if (dy < 0) {
 						endy += dy;
@@ -529,9 +605,9 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 						starty = dy;
 					}
 
-					for (int32_t y = starty; y <= endy; ++y) {
-						for (int32_t x = 0; x <= mapWalkWidth - 2; ++x) {
-							localMapCache[y][x] = localMapCache[y][x + 1];
+					for (auto& rows : walkCache) {
+						for (int32_t y = starty; y <= endy; ++y) {
+							rows[y] >>= 1;
 						}
 					}
 
@@ -544,7 +620,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 					//shift y east
 					int32_t starty = 0;
 					int32_t endy = mapWalkHeight - 1;
-					int32_t dy = Position::getDistanceY(oldPos, newPos);
+					int32_t dy = Position::getOffsetY(oldPos, newPos);
 
 					if (dy < 0) {
 						endy += dy;
@@ -552,9 +628,9 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 						starty = dy;
 					}
 
-					for (int32_t y = starty; y <= endy; ++y) {
-						for (int32_t x = mapWalkWidth - 1; --x >= 0;) {
-							localMapCache[y][x + 1] = localMapCache[y][x];
+					for (auto& rows : walkCache) {
+						for (int32_t y = starty; y <= endy; ++y) {
+							rows[y] = (rows[y] << 1) & walkCacheRowMask;
 						}
 					}
 
@@ -598,7 +674,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 		} else {
 			if (hasExtraSwing()) {
 				//our target is moving lets see if we can get in hit
-				g_dispatcher.addTask(createTask(std::bind(&Game::checkCreatureAttack, &g_game, getID())));
+				g_dispatcher.addTask(createTask("Game::checkCreatureAttack", std::bind(&Game::checkCreatureAttack, &g_game, getID())));
 			}
 
 			if (newTile->getZone() != oldTile->getZone()) {
@@ -885,6 +961,38 @@ void Creature::getPathSearchParams(const Creature*, FindPathParams& fpp) const
 	fpp.maxTargetDist = 1;
 }
 
+bool Creature::willSearchFollowPath(uint32_t interval, FindPathParams& fpp) const
+{
+	// mirrors onThink and goToFollowCreature
+	if (!followCreature || !isMapLoaded) {
+		return false;
+	}
+
+	if (!isUpdatingPath && !forceUpdateFollowPath && walkUpdateTicks + interval < 2000) {
+		return false;
+	}
+
+	if (master != followCreature && !canSeeCreature(followCreature)) {
+		return false;
+	}
+
+	getPathSearchParams(followCreature, fpp);
+
+	// fleeing and distance keeping monsters mostly get by with a single step,
+	// melee chasers with a step from their target's flow field
+	const Monster* monster = getMonster();
+	if (!monster || monster->getMaster()) {
+		return true;
+	}
+
+	if (monster->isFleeing() || fpp.maxTargetDist > 1) {
+		return false;
+	}
+
+	Direction dir;
+	return !monster->getFlowFieldStep(dir);
+}
+
 void Creature::goToFollowCreature()
 {
 	if (followCreature) {
@@ -920,7 +1028,15 @@ void Creature::goToFollowCreature()
 			}
 		} else {
 			listWalkDir.clear();
-			if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+
+			// melee chasers share a flow field of the target, taking one step at a time from it
+			Direction dir;
+			if (monster && monster->getFlowFieldStep(dir)) {
+				listWalkDir.push_front(dir);
+
+				hasFollowPath = true;
+				startAutoWalk(listWalkDir);
+			} else if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
 				hasFollowPath = true;
 				startAutoWalk(listWalkDir);
 			} else {
@@ -1104,7 +1220,7 @@ void Creature::onGainExperience(uint64_t gainExp, Creature* target)
 	gainExp /= 2;
 	master->onGainExperience(gainExp, target);
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, false, true);
 	if (spectators.empty()) {
 		return;
@@ -1132,6 +1248,7 @@ bool Creature::setMaster(Creature* newMaster) {
 
 	Creature* oldMaster = master;
 	master = newMaster;
+	g_game.map.invalidatePathing(getPosition());
 
 	if (oldMaster) {
 		auto summon = std::find(oldMaster->summons.begin(), oldMaster->summons.end(), this);
@@ -1152,7 +1269,7 @@ bool Creature::addCondition(Condition* condition, bool force/* = false*/)
 	if (!force && condition->getType() == CONDITION_HASTE && hasCondition(CONDITION_PARALYZE)) {
 		int64_t walkDelay = getWalkDelay();
 		if (walkDelay > 0) {
-			g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceAddCondition, &g_game, getID(), condition)));
+			g_scheduler.addEvent(createSchedulerTask(walkDelay, "Game::forceAddCondition", std::bind(&Game::forceAddCondition, &g_game, getID(), condition)));
 			return false;
 		}
 	}
@@ -1166,6 +1283,7 @@ bool Creature::addCondition(Condition* condition, bool force/* = false*/)
 
 	if (condition->startCondition(this)) {
 		conditions.push_back(condition);
+		invalidatePathing(*this, condition->getType());
 		onAddCondition(condition->getType());
 		return true;
 	}
@@ -1200,12 +1318,13 @@ void Creature::removeCondition(ConditionType_t type, bool force/* = false*/)
 		if (!force && type == CONDITION_PARALYZE) {
 			int64_t walkDelay = getWalkDelay();
 			if (walkDelay > 0) {
-				g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), type)));
+				g_scheduler.addEvent(createSchedulerTask(walkDelay, "Game::forceRemoveCondition", std::bind(&Game::forceRemoveCondition, &g_game, getID(), type)));
 				return;
 			}
 		}
 
 		it = conditions.erase(it);
+		invalidatePathing(*this, type);
 
 		condition->endCondition(this);
 		delete condition;
@@ -1227,12 +1346,13 @@ void Creature::removeCondition(ConditionType_t type, ConditionId_t conditionId,
 		if (!force && type == CONDITION_PARALYZE) {
 			int64_t walkDelay = getWalkDelay();
 			if (walkDelay > 0) {
-				g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), type)));
+				g_scheduler.addEvent(createSchedulerTask(walkDelay, "Game::forceRemoveCondition", std::bind(&Game::forceRemoveCondition, &g_game, getID(), type)));
 				return;
 			}
 		}
 
 		it = conditions.erase(it);
+		invalidatePathing(*this, type);
 
 		condition->endCondition(this);
 		delete condition;
@@ -1265,12 +1385,13 @@ void Creature::removeCondition(Condition* condition, bool force/* = false*/)
 	if (!force && condition->getType() == CONDITION_PARALYZE) {
 		int64_t walkDelay = getWalkDelay();
 		if (walkDelay > 0) {
-			g_scheduler.addEvent(createSchedulerTask(walkDelay, std::bind(&Game::forceRemoveCondition, &g_game, getID(), condition->getType())));
+			g_scheduler.addEvent(createSchedulerTask(walkDelay, "Game::forceRemoveCondition", std::bind(&Game::forceRemoveCondition, &g_game, getID(), condition->getType())));
 			return;
 		}
 	}
 
 	conditions.erase(it);
+	invalidatePathing(*this, condition->getType());
 
 	condition->endCondition(this);
 	onEndCondition(condition->getType());
@@ -1306,6 +1427,7 @@ void Creature::executeConditions(uint32_t interval)
 			ConditionType_t type = condition->getType();
 
 			it = conditions.erase(it);
+			invalidatePathing(*this, type);
 
 			condition->endCondition(this);
 			delete condition;
@@ -1587,9 +1709,39 @@ bool Creature::isInvisible() const
 	}) != conditions.end();
 }
 
-bool Creature::getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, const FindPathParams& fpp) const
+bool Creature::getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, const FindPathParams& fpp, bool* routeLeg /*= nullptr*/) const
 {
-	return g_game.map.getPathMatching(*this, dirList, FrozenPathingConditionCall(targetPos), fpp);
+	if (routeLeg) {
+		*routeLeg = false;
+	}
+
+	bool found;
+	if (prefetchedPath && g_game.creatureThinkPool.getFollowPath(*this, targetPos, fpp, dirList, found)) {
+		return found;
+	}
+
+	if (g_game.map.getPathMatching(*this, dirList, FrozenPathingConditionCall(targetPos), fpp)) {
+		return true;
+	}
+
+	Position waypoint;
+	if (!routeLeg || fpp.maxSearchDist != 0 || !g_game.map.getRouteWaypoint(getPosition(), targetPos, waypoint)) {
+		return false;
+	}
+
+	// too far for one search, walk the first leg of the route and search again from there
+	FindPathParams legParams;
+	legParams.clearSight = false;
+	legParams.allowDiagonal = fpp.allowDiagonal;
+	legParams.minTargetDist = 0;
+	legParams.maxTargetDist = 0;
+	legParams.maxSearchDist = PATH_CLUSTER_SIZE + PATH_CLUSTER_SIZE / 2;
+	if (!g_game.map.getPathMatching(*this, dirList, FrozenPathingConditionCall(waypoint), legParams)) {
+		return false;
+	}
+
+	*routeLeg = true;
+	return true;
 }
 
 bool Creature::getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, int32_t minTargetDist, int32_t maxTargetDist, bool fullPathSearch /*= true*/, bool clearSight /*= true*/, int32_t maxSearchDist /*= 0*/) const
@@ -58,6 +58,12 @@ struct FindPathParams {
 	int32_t maxTargetDist = -1;
 };
 
+// magic field types the walk cache keeps a layer for, fields of any other type are part of its base layer
+static constexpr CombatType_t WALK_CACHE_FIELD_TYPES[] = {
+	COMBAT_FIREDAMAGE, COMBAT_ENERGYDAMAGE, COMBAT_EARTHDAMAGE, COMBAT_DROWNDAMAGE
+};
+static constexpr int32_t WALK_CACHE_FIELD_LAYERS = 4;
+
 class Map;
 class Thing;
 class Container;
@@ -66,6 +72,7 @@ class Monster;
 class Npc;
 class Item;
 class Tile;
+struct PrefetchedPath;
 
 static constexpr int32_t EVENT_CREATURECOUNT = 10;
 static constexpr int32_t EVENT_CREATURE_THINK_INTERVAL = 1000;
@@ -325,6 +332,10 @@ class Creature : virtual public Thing
 		bool hasCondition(ConditionType_t type, uint32_t subId = 0) const;
 		virtual bool isImmune(ConditionType_t type) const;
 		virtual bool isImmune(CombatType_t type) const;
+		// whether a walk may lead over a non-blocking magic field of this type, see Tile::queryAdd
+		virtual bool canWalkOnField(CombatType_t) const {
+			return true;
+		}
 		virtual bool isSuppress(ConditionType_t type) const;
 		virtual uint32_t getDamageImmunities() const {
 			return 0;
@@ -456,9 +467,17 @@ class Creature : virtual public Thing
 
 		double getDamageRatio(Creature* attacker) const;
 
-		bool getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, const FindPathParams& fpp) const;
+		/**
+		  * Searches a path to targetPos
+		  * \param routeLeg If given and the search fails for a far target without
+		  * maxSearchDist, dirList leads to the end of the first leg of its route
+		  * instead and routeLeg is set to true
+		  */
+		bool getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, const FindPathParams& fpp, bool* routeLeg = nullptr) const;
 		bool getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, int32_t minTargetDist, int32_t maxTargetDist, bool fullPathSearch = true, bool clearSight = true, int32_t maxSearchDist = 0) const;
 
+		bool willSearchFollowPath(uint32_t interval, FindPathParams& fpp) const;
+
 		void incrementReferenceCounter() {
 			++referenceCounter;
 		}
@@ -482,6 +501,16 @@ class Creature : virtual public Thing
 		static constexpr int32_t mapWalkHeight = Map::maxViewportY * 2 + 1;
 		static constexpr int32_t maxWalkCacheWidth = (mapWalkWidth - 1) / 2;
 		static constexpr int32_t maxWalkCacheHeight = (mapWalkHeight - 1) / 2;
+		static constexpr uint32_t walkCacheRowMask = (1U << mapWalkWidth) - 1;
+		static_assert(mapWalkWidth <= 32, "a walk cache row has to fit one word");
+
+		// the walk cache keeps one bit per tile, a word per row of the window around the creature
+		enum WalkCacheLayer_t : uint8_t {
+			WALKCACHE_WALKABLE, // what getWalkCache answers, the base with the avoided fields masked out
+			WALKCACHE_BASE, // walkability with magic fields left aside
+			WALKCACHE_FIELDS, // tiles holding a field, one layer per WALK_CACHE_FIELD_TYPES entry
+			WALKCACHE_LAYERS = WALKCACHE_FIELDS + WALK_CACHE_FIELD_LAYERS,
+		};
 
 		Position position;
 
@@ -498,6 +527,7 @@ class Creature : virtual public Thing
 		Creature* attackedCreature = nullptr;
 		Creature* master = nullptr;
 		Creature* followCreature = nullptr;
+		const PrefetchedPath* prefetchedPath = nullptr;
 
 		uint64_t lastStep = 0;
 		uint32_t referenceCounter = 0;
@@ -521,10 +551,14 @@ class Creature : virtual public Thing
 		Position lastPosition;
 		LightInfo internalLight;
 
+		uint32_t walkCache[WALKCACHE_LAYERS][mapWalkHeight] = {};
+
 		Direction direction = DIRECTION_SOUTH;
 		Skulls_t skull = SKULL_NONE;
 
-		bool localMapCache[mapWalkHeight][mapWalkWidth] = {{ false }};
+		// WALK_CACHE_FIELD_TYPES bits of the fields canWalkOnField refuses
+		uint8_t blockedFieldLayers = 0;
+
 		bool isInternalRemoved = false;
 		bool isMapLoaded = false;
 		bool isUpdatingPath = false;
@@ -546,6 +580,8 @@ class Creature : virtual public Thing
 		void updateMapCache();
 		void updateTileCache(const Tile* tile, int32_t dx, int32_t dy);
 		void updateTileCache(const Tile* tile, const Position& pos);
+		void updateWalkCacheFields();
+		uint8_t getBlockedFieldLayers() const;
 		void onCreatureDisappear(const Creature* creature, bool isLogout);
 		virtual void doAttacking(uint32_t) {}
 		virtual bool hasExtraSwing() {
@@ -567,6 +603,40 @@ class Creature : virtual public Thing
 		friend class Game;
 		friend class Map;
 		friend class LuaScriptInterface;
+		friend class CreatureThinkPool;
 };
 
+// defined here as it needs the complete Creature, map.h only declares it
+template<typename Callback>
+bool Map::queryCreatures(const SpatialArea& area, SpatialFilter_t filter, Callback&& callback) const
+{
+	return forEachAreaFloor(area, [&](const Floor& floor, int32_t, int32_t, int32_t nz) {
+		// the creatures of a floor are on its z already, only the box of that floor and the radius are left to check
+		const int32_t offset = area.getFloorOffset(nz);
+		const int32_t minX = area.minX + offset, maxX = area.maxX + offset;
+		const int32_t minY = area.minY + offset, maxY = area.maxY + offset;
+
+		const CreatureVector& node_list = (filter == SPATIALFILTER_PLAYERS ? floor.player_list : floor.creature_list);
+		for (Creature* creature : node_list) {
+			const Position& pos = creature->getPosition();
+			if (pos.x < minX || pos.x > maxX || pos.y < minY || pos.y > maxY) {
+				continue;
+			}
+
+			if (area.radius >= 0 && !area.isInRadius(pos.x, pos.y)) {
+				continue;
+			}
+
+			if ((filter == SPATIALFILTER_MONSTERS && !creature->getMonster()) || (filter == SPATIALFILTER_NPCS && !creature->getNpc())) {
+				continue;
+			}
+
+			if (!callback(creature)) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
 #endif
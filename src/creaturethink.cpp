@@ -0,0 +1,269 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "creaturethink.h"
+#include "configmanager.h"
+#include "game.h"
+
+extern ConfigManager g_config;
+extern Game g_game;
+
+static bool operator==(const FindPathParams& lhs, const FindPathParams& rhs)
+{
+	return lhs.fullPathSearch == rhs.fullPathSearch && lhs.clearSight == rhs.clearSight && lhs.allowDiagonal == rhs.allowDiagonal &&
+	       lhs.keepDistance == rhs.keepDistance && lhs.maxSearchDist == rhs.maxSearchDist &&
+	       lhs.minTargetDist == rhs.minTargetDist && lhs.maxTargetDist == rhs.maxTargetDist;
+}
+
+bool PrefetchedPath::isRequest(const Creature& creature, const Position& targetPos, const FindPathParams& fpp) const
+{
+	return startPos == creature.getPosition() && this->targetPos == targetPos && this->fpp == fpp;
+}
+
+static int64_t getElapsedMicroseconds(std::chrono::steady_clock::time_point since)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+CreatureThinkPool::~CreatureThinkPool()
+{
+	shutdown();
+}
+
+void CreatureThinkPool::start(int32_t threadCount)
+{
+	if (threadCount <= 0) {
+		// the dispatcher searches alongside the workers
+		threadCount = std::max<int32_t>(1, static_cast<int32_t>(std::thread::hardware_concurrency()) - 1);
+	}
+
+	threads.reserve(threadCount);
+	for (int32_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&CreatureThinkPool::threadMain, this);
+	}
+	std::cout << "> Creature think pool started with " << threadCount << " threads." << std::endl;
+}
+
+void CreatureThinkPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(taskLock);
+		stopping = true;
+	}
+	taskSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+}
+
+void CreatureThinkPool::prepareFollowPaths(const std::list<Creature*>& creatures, uint32_t interval)
+{
+	if (stopping) {
+		return;
+	}
+
+	for (Creature* creature : creatures) {
+		// player searches also read house invitations, pz locks and the players
+		// they may walk through, only monsters are searched ahead
+		if (!creature->getMonster() || !creature->creatureCheck || creature->getHealth() <= 0) {
+			continue;
+		}
+
+		FindPathParams fpp;
+		if (!creature->willSearchFollowPath(interval, fpp) || fpp.maxSearchDist == 0) {
+			// unbounded searches may take a route leg instead and read the whole map
+			continue;
+		}
+
+		const Position& pos = creature->getPosition();
+		const Position& targetPos = creature->followCreature->getPosition();
+
+		paths.emplace_back();
+		PrefetchedPath& path = paths.back();
+		path.creature = creature;
+		path.startPos = pos;
+		path.targetPos = targetPos;
+		path.fpp = fpp;
+		path.region = (static_cast<uint32_t>(pos.x >> FLOOR_BITS) << 16) | (pos.y >> FLOOR_BITS);
+
+		// the search never leaves maxSearchDist around the start, the sight
+		// checks never leave maxTargetDist around the target, plus the
+		// neighbours a tile's cost is read from
+		const int32_t searchRange = fpp.maxSearchDist + 1;
+		const int32_t targetRange = std::max<int32_t>(fpp.maxTargetDist, 0) + 1;
+		path.fromPos.x = std::max<int32_t>(0, std::min<int32_t>(pos.getX() - searchRange, targetPos.getX() - targetRange));
+		path.fromPos.y = std::max<int32_t>(0, std::min<int32_t>(pos.getY() - searchRange, targetPos.getY() - targetRange));
+		path.toPos.x = std::min<int32_t>(0xFFFF, std::max<int32_t>(pos.getX() + searchRange, targetPos.getX() + targetRange));
+		path.toPos.y = std::min<int32_t>(0xFFFF, std::max<int32_t>(pos.getY() + searchRange, targetPos.getY() + targetRange));
+		path.pathingRevision = g_game.map.getPathingRevision(path.fromPos, path.toPos);
+	}
+
+	if (paths.empty()) {
+		return;
+	}
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// creatures sharing a QTree leaf are searched by the same thread, their
+	// searches mostly touch the same tiles
+	std::stable_sort(paths.begin(), paths.end(), [](const PrefetchedPath& lhs, const PrefetchedPath& rhs) {
+		return lhs.region < rhs.region;
+	});
+
+	for (size_t begin = 0, end = 0; begin < paths.size(); begin = end) {
+		const uint32_t region = paths[begin].region;
+		while (end < paths.size() && paths[end].region == region) {
+			++end;
+		}
+		regions.emplace_back(begin, end);
+	}
+
+	if (regions.size() > 1) {
+		if (threads.empty()) {
+			start(g_config.getNumber(ConfigManager::CREATURE_THINK_THREADS));
+		}
+
+		{
+			std::lock_guard<std::mutex> lockGuard(taskLock);
+			nextRegion.store(0, std::memory_order_relaxed);
+			regionCount = regions.size();
+			++generation;
+		}
+		taskSignal.notify_all();
+
+		searchRegions();
+
+		// the map must not change while a worker is still searching it
+		std::unique_lock<std::mutex> lockGuard(taskLock);
+		doneSignal.wait(lockGuard, [this]() { return activeThreads == 0; });
+		regionCount = 0;
+	} else {
+		searchRegion(regions.front());
+	}
+
+	++stats.rounds;
+	stats.searched += paths.size();
+	stats.wallTime += getElapsedMicroseconds(startTime);
+
+	for (PrefetchedPath& path : paths) {
+		path.creature->prefetchedPath = &path;
+	}
+}
+
+bool CreatureThinkPool::getFollowPath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp,
+                                      std::forward_list<Direction>& dirList, bool& found)
+{
+	const PrefetchedPath* path = creature.prefetchedPath;
+	if (!path || !path->isRequest(creature, targetPos, fpp)) {
+		return false;
+	}
+
+	if (path->pathingRevision != g_game.map.getPathingRevision(path->fromPos, path->toPos)) {
+		++stats.stale;
+		return false;
+	}
+
+	++stats.used;
+	dirList.insert_after(dirList.before_begin(), path->dirList.begin(), path->dirList.end());
+	found = path->found;
+	return true;
+}
+
+CreatureThinkStats CreatureThinkPool::takeStats()
+{
+	CreatureThinkStats result = stats;
+	result.searchTime = searchTime.exchange(0, std::memory_order_relaxed);
+	stats = CreatureThinkStats();
+	return result;
+}
+
+void CreatureThinkPool::reportStats()
+{
+	CreatureThinkStats result = takeStats();
+	if (result.searched == 0) {
+		return;
+	}
+
+	// search time over wall time is how far the search phase scaled across the threads
+	std::cout << ">> Creature think pool: " << result.searched << " paths searched ahead in " << result.rounds << " rounds on "
+	          << threads.size() + 1 << " threads, " << result.searchTime / 1000 << " ms of searching in "
+	          << result.wallTime / 1000 << " ms (" << std::fixed << std::setprecision(1)
+	          << (result.wallTime > 0 ? static_cast<double>(result.searchTime) / result.wallTime : 0.) << "x), "
+	          << result.used << " used, " << result.stale << " stale." << std::endl;
+}
+
+void CreatureThinkPool::clearFollowPaths()
+{
+	for (PrefetchedPath& path : paths) {
+		path.creature->prefetchedPath = nullptr;
+	}
+	paths.clear();
+	regions.clear();
+}
+
+void CreatureThinkPool::searchRegions()
+{
+	size_t index;
+	while ((index = nextRegion.fetch_add(1, std::memory_order_relaxed)) < regionCount) {
+		searchRegion(regions[index]);
+	}
+}
+
+void CreatureThinkPool::searchRegion(const std::pair<size_t, size_t>& region)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	for (size_t i = region.first; i < region.second; ++i) {
+		PrefetchedPath& path = paths[i];
+		path.found = g_game.map.getPathMatching(*path.creature, path.dirList, FrozenPathingConditionCall(path.targetPos), path.fpp);
+	}
+	searchTime.fetch_add(getElapsedMicroseconds(startTime), std::memory_order_relaxed);
+}
+
+void CreatureThinkPool::threadMain()
+{
+	uint64_t lastGeneration = 0;
+
+	std::unique_lock<std::mutex> lockGuard(taskLock);
+	while (true) {
+		taskSignal.wait(lockGuard, [&]() { return stopping || generation != lastGeneration; });
+		if (stopping) {
+			break;
+		}
+
+		lastGeneration = generation;
+		if (nextRegion.load(std::memory_order_relaxed) >= regionCount) {
+			// woke up after the dispatcher already finished this round
+			continue;
+		}
+
+		++activeThreads;
+		lockGuard.unlock();
+
+		searchRegions();
+
+		lockGuard.lock();
+		if (--activeThreads == 0) {
+			doneSignal.notify_one();
+		}
+	}
+}
@@ -0,0 +1,120 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_CREATURETHINK_H_48304553BEC1F1763FDB18C9A2BA8AD9
+#define FS_CREATURETHINK_H_48304553BEC1F1763FDB18C9A2BA8AD9
+
+#include <condition_variable>
+#include <forward_list>
+#include <thread>
+
+#include "creature.h"
+
+// A follow path searched by the think pool ahead of the creature's own think,
+// only handed out while nothing pathfinding reads has changed since
+struct PrefetchedPath {
+	Creature* creature;
+	std::forward_list<Direction> dirList;
+	Position startPos;
+	Position targetPos;
+	// every tile the search may have read lies in this box
+	Position fromPos;
+	Position toPos;
+	FindPathParams fpp;
+	uint32_t region;
+	uint32_t pathingRevision;
+	bool found = false;
+
+	bool isRequest(const Creature& creature, const Position& targetPos, const FindPathParams& fpp) const;
+};
+
+struct CreatureThinkStats {
+	uint64_t rounds = 0; // think buckets searched on the pool
+	uint64_t searched = 0;
+	uint64_t used = 0;
+	uint64_t stale = 0; // requested again after the map around them changed
+	int64_t wallTime = 0; // microseconds the dispatcher spent in the search phase
+	int64_t searchTime = 0; // microseconds spent searching, summed over all threads
+};
+
+class CreatureThinkPool
+{
+	public:
+		CreatureThinkPool() = default;
+		~CreatureThinkPool();
+
+		// non-copyable
+		CreatureThinkPool(const CreatureThinkPool&) = delete;
+		CreatureThinkPool& operator=(const CreatureThinkPool&) = delete;
+
+		/**
+		  * Searches the follow paths the given creatures are about to recompute
+		  * on the worker threads, sharded by map region, and attaches the results
+		  * to the creatures until clearFollowPaths is called
+		  * \param creatures The think bucket about to be checked
+		  * \param interval The think interval passed to the creatures
+		  */
+		void prepareFollowPaths(const std::list<Creature*>& creatures, uint32_t interval);
+		void clearFollowPaths();
+
+		/**
+		  * Hands out the path searched ahead for this request while nothing the
+		  * search read has changed since
+		  * \returns true if dirList and found were set from the searched path
+		  */
+		bool getFollowPath(const Creature& creature, const Position& targetPos, const FindPathParams& fpp,
+		                   std::forward_list<Direction>& dirList, bool& found);
+
+		CreatureThinkStats takeStats();
+		void reportStats();
+		size_t getThreadCount() const {
+			return threads.size();
+		}
+
+		/**
+		  * Starts the worker threads, prepareFollowPaths does so on first use
+		  * with creatureThinkThreads from config.lua
+		  * \param threadCount The number of workers, 0 for one less than the CPU count
+		  */
+		void start(int32_t threadCount);
+		void shutdown();
+
+	private:
+		void threadMain();
+		void searchRegions();
+		void searchRegion(const std::pair<size_t, size_t>& region);
+
+		std::vector<std::thread> threads;
+		std::vector<PrefetchedPath> paths;
+		// [begin, end) ranges into paths, one per map region
+		std::vector<std::pair<size_t, size_t>> regions;
+
+		std::mutex taskLock;
+		std::condition_variable taskSignal;
+		std::condition_variable doneSignal;
+		std::atomic<size_t> nextRegion{0};
+		std::atomic<int64_t> searchTime{0};
+		CreatureThinkStats stats;
+		size_t regionCount = 0;
+		size_t activeThreads = 0;
+		uint64_t generation = 0;
+		bool stopping = false;
+};
+
+#endif
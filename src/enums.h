@@ -558,6 +558,13 @@ struct ModalWindow
 		: title(std::move(title)), message(std::move(message)), id(id), defaultEnterButton(0xFF), defaultEscapeButton(0xFF), priority(false) {}
 };
 
+enum SpatialFilter_t : uint8_t {
+	SPATIALFILTER_ALL,
+	SPATIALFILTER_PLAYERS,
+	SPATIALFILTER_MONSTERS,
+	SPATIALFILTER_NPCS,
+};
+
 enum CombatOrigin
 {
 	ORIGIN_NONE,
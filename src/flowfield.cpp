@@ -0,0 +1,97 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "flowfield.h"
+#include "map.h"
+
+#include <queue>
+
+namespace {
+
+constexpr int32_t neighborOffsets[8][2] = {
+	{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+};
+
+}
+
+void FlowField::build(const Map& map, const Position& targetPos)
+{
+	this->targetPos = targetPos;
+	costs.assign(FLOW_FIELD_SIZE * FLOW_FIELD_SIZE, -1);
+
+	const int32_t originX = targetPos.x - FLOW_FIELD_RADIUS;
+	const int32_t originY = targetPos.y - FLOW_FIELD_RADIUS;
+
+	// the same step costs as getPathMatching
+	using Entry = std::pair<int32_t, int32_t>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+	const int32_t targetCell = FLOW_FIELD_RADIUS * FLOW_FIELD_SIZE + FLOW_FIELD_RADIUS;
+	costs[targetCell] = 0;
+	open.emplace(0, targetCell);
+
+	while (!open.empty()) {
+		const Entry entry = open.top();
+		open.pop();
+		if (entry.first > costs[entry.second]) {
+			continue;
+		}
+
+		const int32_t x = entry.second % FLOW_FIELD_SIZE;
+		const int32_t y = entry.second / FLOW_FIELD_SIZE;
+		for (int32_t i = 0; i < 8; ++i) {
+			const int32_t nx = x + neighborOffsets[i][0];
+			const int32_t ny = y + neighborOffsets[i][1];
+			if (nx < 0 || ny < 0 || nx >= FLOW_FIELD_SIZE || ny >= FLOW_FIELD_SIZE) {
+				continue;
+			}
+
+			const int32_t cell = ny * FLOW_FIELD_SIZE + nx;
+			const int32_t cost = entry.first + (i >= 4 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+			if (costs[cell] >= 0 && costs[cell] <= cost) {
+				continue;
+			}
+
+			const int32_t mapX = originX + nx;
+			const int32_t mapY = originY + ny;
+			if (mapX < 0 || mapY < 0 || mapX > 0xFFFF || mapY > 0xFFFF || map.isPathBlocked(mapX, mapY, targetPos.z)) {
+				continue;
+			}
+
+			costs[cell] = cost;
+			open.emplace(cost, cell);
+		}
+	}
+}
+
+int32_t FlowField::getCost(const Position& pos) const
+{
+	if (pos.z != targetPos.z) {
+		return -1;
+	}
+
+	const int32_t x = pos.x - targetPos.x + FLOW_FIELD_RADIUS;
+	const int32_t y = pos.y - targetPos.y + FLOW_FIELD_RADIUS;
+	if (x < 0 || y < 0 || x >= FLOW_FIELD_SIZE || y >= FLOW_FIELD_SIZE) {
+		return -1;
+	}
+	return costs[y * FLOW_FIELD_SIZE + x];
+}
@@ -0,0 +1,62 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_FLOWFIELD_H_3C6253072F3171B3AD13C63A3494527E
+#define FS_FLOWFIELD_H_3C6253072F3171B3AD13C63A3494527E
+
+#include "position.h"
+
+class Map;
+
+static constexpr int32_t FLOW_FIELD_RADIUS = 16;
+static constexpr int32_t FLOW_FIELD_SIZE = FLOW_FIELD_RADIUS * 2 + 1;
+
+/**
+  * Walking costs from every tile around a target position to it, so any number
+  * of creatures chasing the same target can step downhill instead of each
+  * running its own A*. Only static walkability is considered, the creatures
+  * check the tile they are about to step on themselves.
+  */
+class FlowField
+{
+	public:
+		void build(const Map& map, const Position& targetPos);
+
+		bool isBuilt() const {
+			return !costs.empty();
+		}
+		void invalidate() {
+			costs.clear();
+		}
+
+		// whether walkability on pos is part of this field
+		bool covers(const Position& pos) const {
+			return pos.z == targetPos.z && Position::getDistanceX(pos, targetPos) <= FLOW_FIELD_RADIUS &&
+			       Position::getDistanceY(pos, targetPos) <= FLOW_FIELD_RADIUS;
+		}
+
+		// -1 if pos is outside of the field or cannot reach the target
+		int32_t getCost(const Position& pos) const;
+
+	private:
+		std::vector<int32_t> costs;
+		Position targetPos;
+};
+
+#endif
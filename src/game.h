@@ -22,6 +22,7 @@
 
 #include "account.h"
 #include "combat.h"
+#include "creaturethink.h"
 #include "groups.h"
 #include "map.h"
 #include "position.h"
@@ -214,7 +215,7 @@ class Game
 		bool removeCreature(Creature* creature, bool isLogout = true);
 
 		void addCreatureCheck(Creature* creature);
-		static void removeCreatureCheck(Creature* creature);
+		void removeCreatureCheck(Creature* creature);
 
 		size_t getPlayersOnline() const {
 			return players.size();
@@ -225,6 +226,16 @@ class Game
 		size_t getNpcsOnline() const {
 			return npcs.size();
 		}
+
+		// creatures in the think rotation and idle monsters left out of it
+		size_t getThinkingCreatureCount() const {
+			return thinkingCreatures;
+		}
+		size_t getDormantMonsterCount() const {
+			return monsters.size() - thinkingMonsters;
+		}
+		void reportCreatureStats() const;
+
 		uint32_t getPlayersRecord() const {
 			return playersRecord;
 		}
@@ -307,7 +318,7 @@ class Game
 		  * \param text The text to say
 		  */
 		bool internalCreatureSay(Creature* creature, SpeakClasses type, const std::string& text,
-		                         bool ghostMode, SpectatorHashSet* spectatorsPtr = nullptr, const Position* pos = nullptr);
+		                         bool ghostMode, SpectatorVec* spectatorsPtr = nullptr, const Position* pos = nullptr);
 
 		void loadPlayersRecord();
 		void checkPlayersRecord();
@@ -444,11 +455,11 @@ class Game
 
 		//animation help functions
 		void addCreatureHealth(const Creature* target);
-		static void addCreatureHealth(const SpectatorHashSet& spectators, const Creature* target);
+		static void addCreatureHealth(const SpectatorVec& spectators, const Creature* target);
 		void addMagicEffect(const Position& pos, uint8_t effect);
-		static void addMagicEffect(const SpectatorHashSet& spectators, const Position& pos, uint8_t effect);
+		static void addMagicEffect(const SpectatorVec& spectators, const Position& pos, uint8_t effect);
 		void addDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect);
-		static void addDistanceEffect(const SpectatorHashSet& spectators, const Position& fromPos, const Position& toPos, uint8_t effect);
+		static void addDistanceEffect(const SpectatorVec& spectators, const Position& fromPos, const Position& toPos, uint8_t effect);
 
 		void startDecay(Item* item);
 		int32_t getLightHour() const {
@@ -502,6 +513,7 @@ class Game
 		Mounts mounts;
 		Raids raids;
 		Quests quests;
+		CreatureThinkPool creatureThinkPool;
 
 	protected:
 		bool playerSaySpell(Player* player, SpeakClasses type, const std::string& text);
@@ -511,6 +523,8 @@ class Game
 		void playerSpeakToNpc(Player* player, const std::string& text);
 
 		void checkDecay();
+		void checkMapClean();
+		void cleanMapSlice();
 		void internalDecayItem(Item* item);
 
 		std::unordered_map<uint32_t, Player*> players;
@@ -521,6 +535,8 @@ class Game
 
 		std::list<Item*> decayItems[EVENT_DECAY_BUCKETS];
 		std::list<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
+		size_t thinkingCreatures = 0;
+		size_t thinkingMonsters = 0;
 
 		std::forward_list<Item*> toDecayItems;
 
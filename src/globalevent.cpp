@@ -75,7 +75,7 @@ bool GlobalEvents::registerEvent(Event* event, const pugi::xml_node&)
 		auto result = timerMap.emplace(globalEvent->getName(), globalEvent);
 		if (result.second) {
 			if (timerEventId == 0) {
-				timerEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, std::bind(&GlobalEvents::timer, this)));
+				timerEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, "GlobalEvents::timer", std::bind(&GlobalEvents::timer, this)));
 			}
 			return true;
 		}
@@ -88,7 +88,7 @@ bool GlobalEvents::registerEvent(Event* event, const pugi::xml_node&)
 		auto result = thinkMap.emplace(globalEvent->getName(), globalEvent);
 		if (result.second) {
 			if (thinkEventId == 0) {
-				thinkEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, std::bind(&GlobalEvents::think, this)));
+				thinkEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, "GlobalEvents::think", std::bind(&GlobalEvents::think, this)));
 			}
 			return true;
 		}
@@ -139,7 +139,7 @@ void GlobalEvents::timer()
 	}
 
 	if (nextScheduledTime != std::numeric_limits<int64_t>::max()) {
-		timerEventId = g_scheduler.addEvent(createSchedulerTask(std::max<int64_t>(1000, nextScheduledTime * 1000),
+		timerEventId = g_scheduler.addEvent(createSchedulerTask(std::max<int64_t>(1000, nextScheduledTime * 1000), "GlobalEvents::timer",
 							                std::bind(&GlobalEvents::timer, this)));
 	}
 }
@@ -173,7 +173,7 @@ void GlobalEvents::think()
 	}
 
 	if (nextScheduledTime != std::numeric_limits<int64_t>::max()) {
-		thinkEventId = g_scheduler.addEvent(createSchedulerTask(nextScheduledTime, std::bind(&GlobalEvents::think, this)));
+		thinkEventId = g_scheduler.addEvent(createSchedulerTask(nextScheduledTime, "GlobalEvents::think", std::bind(&GlobalEvents::think, this)));
 	}
 }
 
@@ -22,6 +22,7 @@
 #include "iologindata.h"
 #include "configmanager.h"
 #include "game.h"
+#include "replay.h"
 
 extern ConfigManager g_config;
 extern Game g_game;
@@ -639,6 +640,11 @@ bool IOLoginData::saveItems(const Player* player, const ItemBlockList& itemList,
 
 bool IOLoginData::savePlayer(Player* player)
 {
+	// a replay leaves the database as it was recorded against
+	if (g_replay.isReplaying()) {
+		return true;
+	}
+
 	if (player->getHealth() <= 0) {
 		player->changeHealth(1);
 	}
@@ -22,6 +22,11 @@
 #include "iomap.h"
 
 #include "bed.h"
+#include "depotlocker.h"
+#include "iomapserialize.h"
+
+#include <atomic>
+#include <fstream>
 
 /*
 	OTBM_ROOTV1
@@ -47,6 +52,58 @@
 	|--- OTBM_ITEM_DEF (not implemented)
 */
 
+// A tile as read from the map file, before any game state is touched
+struct DecodedTile {
+	uint16_t x;
+	uint16_t y;
+	uint32_t houseId = 0;
+	uint32_t flags = TILESTATE_NONE;
+	bool isHouseTile = false;
+
+	// with a node, the item attributes still have to be read on the loading thread
+	std::vector<std::pair<Item*, const OTB::Node*>> items;
+	// the game's unique item registry is not thread-safe, the loading thread fills it
+	Item::UniqueIdList uniqueIds;
+};
+
+struct DecodedTileArea {
+	DecodedTileArea() = default;
+	DecodedTileArea(DecodedTileArea&&) = default;
+
+	// non-copyable
+	DecodedTileArea(const DecodedTileArea&) = delete;
+	DecodedTileArea& operator=(const DecodedTileArea&) = delete;
+
+	const OTB::Node* node = nullptr;
+	uint8_t z = 0;
+	std::vector<DecodedTile> tiles;
+	std::string error;
+
+	~DecodedTileArea() {
+		for (DecodedTile& tile : tiles) {
+			for (const auto& it : tile.items) {
+				delete it.first;
+			}
+		}
+	}
+};
+
+// unique ids read on a decoding thread are kept with their tile until it is built
+class UniqueIdCollectorScope
+{
+	public:
+		explicit UniqueIdCollectorScope(Item::UniqueIdList& list) {
+			Item::setUniqueIdCollector(&list);
+		}
+		~UniqueIdCollectorScope() {
+			Item::setUniqueIdCollector(nullptr);
+		}
+
+		// non-copyable
+		UniqueIdCollectorScope(const UniqueIdCollectorScope&) = delete;
+		UniqueIdCollectorScope& operator=(const UniqueIdCollectorScope&) = delete;
+};
+
 Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8_t z)
 {
 	if (!ground) {
@@ -69,8 +126,32 @@ Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8
 bool IOMap::loadMap(Map* map, const std::string& fileName)
 {
 	int64_t start = OTSYS_TIME();
+
+	std::string snapshotFile;
+	uint64_t sourceHash = 0;
+	if (g_config.getBoolean(ConfigManager::MAP_SNAPSHOT)) {
+		snapshotFile = fileName.substr(0, fileName.rfind('.')) + ".snapshot";
+		sourceHash = getSnapshotSourceHash(fileName);
+
+		switch (loadSnapshot(*map, snapshotFile, sourceHash)) {
+			case SNAPSHOT_LOADED:
+				std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds (snapshot " << snapshotFile << ")." << std::endl;
+				return true;
+
+			case SNAPSHOT_INVALID:
+				return false;
+
+			default:
+				std::cout << "> Map snapshot " << snapshotFile << " is missing or outdated, it will be rebuilt." << std::endl;
+				snapshotTiles.reset(new PropWriteStream());
+				snapshotAreas = 0;
+				break;
+		}
+	}
+
 	OTB::Loader loader{fileName, OTB::Identifier{{'O', 'T', 'B', 'M'}}};
 	auto& root = loader.parseTree();
+	loadStats.treeTime = OTSYS_TIME() - start;
 
 	PropStream propStream;
 	if (!loader.getProps(root, propStream)) {
@@ -131,12 +212,31 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		return false;
 	}
 
+	loadStats.threads = std::max<uint32_t>(1, std::thread::hardware_concurrency());
+	const size_t batchSize = loadStats.threads * 4;
+
+	std::vector<DecodedTileArea> tileAreas;
+	tileAreas.reserve(batchSize);
 	for (auto& mapDataNode : mapNode.children) {
 		if (mapDataNode.type == OTBM_TILE_AREA) {
-			if (!parseTileArea(loader, mapDataNode, *map)) {
-				return false;
+			tileAreas.emplace_back();
+			tileAreas.back().node = &mapDataNode;
+			if (tileAreas.size() == batchSize) {
+				if (!loadTileAreas(loader, tileAreas, *map)) {
+					return false;
+				}
+				tileAreas.clear();
 			}
-		} else if (mapDataNode.type == OTBM_TOWNS) {
+			continue;
+		}
+
+		// towns and waypoints are loaded in file order, after the areas before them
+		if (!loadTileAreas(loader, tileAreas, *map)) {
+			return false;
+		}
+		tileAreas.clear();
+
+		if (mapDataNode.type == OTBM_TOWNS) {
 			if (!parseTowns(loader, mapDataNode, *map)) {
 				return false;
 			}
@@ -150,7 +250,62 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		}
 	}
 
-	std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+	if (!loadTileAreas(loader, tileAreas, *map)) {
+		return false;
+	}
+
+	if (snapshotTiles) {
+		saveSnapshot(*map, snapshotFile, sourceHash);
+		snapshotTiles.reset();
+	}
+
+	std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds (file " << loadStats.treeTime / 1000.
+	          << ", decoding " << loadStats.decodeTime / 1000. << " on " << loadStats.threads << " threads, building "
+	          << loadStats.buildTime / 1000. << ")." << std::endl;
+	return true;
+}
+
+bool IOMap::loadTileAreas(OTB::Loader& loader, std::vector<DecodedTileArea>& areas, Map& map)
+{
+	if (areas.empty()) {
+		return true;
+	}
+
+	// decoding only reads the file and creates items, the map is built on this thread
+	int64_t decodeStart = OTSYS_TIME();
+	std::atomic<size_t> nextArea(0);
+	auto decodeAreas = [&]() {
+		size_t index;
+		while ((index = nextArea.fetch_add(1, std::memory_order_relaxed)) < areas.size()) {
+			decodeTileArea(loader, areas[index]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	size_t threadCount = std::min<size_t>(loadStats.threads, areas.size());
+	for (size_t i = 1; i < threadCount; ++i) {
+		threads.emplace_back(decodeAreas);
+	}
+	decodeAreas();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	int64_t buildStart = OTSYS_TIME();
+	loadStats.decodeTime += buildStart - decodeStart;
+
+	for (DecodedTileArea& area : areas) {
+		if (!area.error.empty()) {
+			setLastErrorString(area.error);
+			return false;
+		}
+
+		if (!buildTileArea(&loader, area, map)) {
+			return false;
+		}
+	}
+
+	loadStats.buildTime += OTSYS_TIME() - buildStart;
 	return true;
 }
 
@@ -203,70 +358,63 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 	return true;
 }
 
-bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map)
+bool IOMap::decodeTileArea(OTB::Loader& loader, DecodedTileArea& area)
 {
+	const OTB::Node& tileAreaNode = *area.node;
+
 	PropStream propStream;
 	if (!loader.getProps(tileAreaNode, propStream)) {
-		setLastErrorString("Invalid map node.");
+		area.error = "Invalid map node.";
 		return false;
 	}
 
 	OTBM_Destination_coords area_coord;
 	if (!propStream.read(area_coord)) {
-		setLastErrorString("Invalid map node.");
+		area.error = "Invalid map node.";
 		return false;
 	}
 
 	uint16_t base_x = area_coord.x;
 	uint16_t base_y = area_coord.y;
 	uint16_t z = area_coord.z;
+	area.z = area_coord.z;
 
+	area.tiles.reserve(tileAreaNode.children.size());
 	for (auto& tileNode : tileAreaNode.children) {
 		if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
-			setLastErrorString("Unknown tile node.");
+			area.error = "Unknown tile node.";
 			return false;
 		}
 
 		if (!loader.getProps(tileNode, propStream)) {
-			setLastErrorString("Could not read node data.");
+			area.error = "Could not read node data.";
 			return false;
 		}
 
 		OTBM_Tile_coords tile_coord;
 		if (!propStream.read(tile_coord)) {
-			setLastErrorString("Could not read tile position.");
+			area.error = "Could not read tile position.";
 			return false;
 		}
 
-		uint16_t x = base_x + tile_coord.x;
-		uint16_t y = base_y + tile_coord.y;
+		area.tiles.emplace_back();
+		DecodedTile& tile = area.tiles.back();
+		tile.x = base_x + tile_coord.x;
+		tile.y = base_y + tile_coord.y;
 
-		bool isHouseTile = false;
-		House* house = nullptr;
-		Tile* tile = nullptr;
-		Item* ground_item = nullptr;
-		uint32_t tileflags = TILESTATE_NONE;
+		uint16_t x = tile.x;
+		uint16_t y = tile.y;
+
+		UniqueIdCollectorScope uniqueIdScope(tile.uniqueIds);
 
 		if (tileNode.type == OTBM_HOUSETILE) {
-			uint32_t houseId;
-			if (!propStream.read<uint32_t>(houseId)) {
+			if (!propStream.read<uint32_t>(tile.houseId)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
-				setLastErrorString(ss.str());
-				return false;
-			}
-
-			house = map.houses.addHouse(houseId);
-			if (!house) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << houseId;
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
-
-			tile = new HouseTile(x, y, z, house);
-			house->addTile(static_cast<HouseTile*>(tile));
-			isHouseTile = true;
+			tile.isHouseTile = true;
 		}
 
 		uint8_t attribute;
@@ -278,20 +426,20 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 					if (!propStream.read<uint32_t>(flags)) {
 						std::ostringstream ss;
 						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to read tile flags.";
-						setLastErrorString(ss.str());
+						area.error = ss.str();
 						return false;
 					}
 
 					if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
-						tileflags |= TILESTATE_PROTECTIONZONE;
+						tile.flags |= TILESTATE_PROTECTIONZONE;
 					} else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
-						tileflags |= TILESTATE_NOPVPZONE;
+						tile.flags |= TILESTATE_NOPVPZONE;
 					} else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
-						tileflags |= TILESTATE_PVPZONE;
+						tile.flags |= TILESTATE_PVPZONE;
 					}
 
 					if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
-						tileflags |= TILESTATE_NOLOGOUT;
+						tile.flags |= TILESTATE_NOLOGOUT;
 					}
 					break;
 				}
@@ -301,39 +449,18 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 					if (!item) {
 						std::ostringstream ss;
 						ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-						setLastErrorString(ss.str());
+						area.error = ss.str();
 						return false;
 					}
 
-					if (isHouseTile && item->isMoveable()) {
-						std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
-						delete item;
-					} else {
-						if (item->getItemCount() <= 0) {
-							item->setItemCount(1);
-						}
-
-						if (tile) {
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						} else if (item->isGroundTile()) {
-							delete ground_item;
-							ground_item = item;
-						} else {
-							tile = createTile(ground_item, item, x, y, z);
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						}
-					}
+					tile.items.emplace_back(item, nullptr);
 					break;
 				}
 
 				default:
 					std::ostringstream ss;
 					ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown tile attribute.";
-					setLastErrorString(ss.str());
+					area.error = ss.str();
 					return false;
 			}
 		}
@@ -342,13 +469,13 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			if (itemNode.type != OTBM_ITEM) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
 
 			PropStream stream;
 			if (!loader.getProps(itemNode, stream)) {
-				setLastErrorString("Invalid item node.");
+				area.error = "Invalid item node.";
 				return false;
 			}
 
@@ -356,18 +483,147 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			if (!item) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				return false;
 			}
 
+			// a bed looks its sleeper up in the database and registers it with the game
+			if (item->getBed()) {
+				tile.items.emplace_back(item, &itemNode);
+				continue;
+			}
+
 			if (!item->unserializeItemNode(loader, itemNode, stream)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
-				setLastErrorString(ss.str());
+				area.error = ss.str();
 				delete item;
 				return false;
 			}
 
+			tile.items.emplace_back(item, nullptr);
+		}
+	}
+	return true;
+}
+
+namespace {
+
+// IOMapSerialize::saveItem only writes what the database keeps for a house item,
+// the snapshot also needs the attributes that only the map file sets
+void saveSnapshotItem(PropWriteStream& stream, const Item* item)
+{
+	stream.write<uint16_t>(item->getID());
+
+	const Door* door = item->getDoor();
+	if (door) {
+		// a door writes nothing for the database, its state comes from the map
+		item->Item::serializeAttr(stream);
+	} else {
+		item->serializeAttr(stream);
+	}
+
+	uint16_t actionId = item->getActionId();
+	if (actionId != 0 && !Item::items[item->getID()].moveable) {
+		stream.write<uint8_t>(ATTR_ACTION_ID);
+		stream.write<uint16_t>(actionId);
+	}
+
+	if (item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
+		stream.write<uint8_t>(ATTR_UNIQUE_ID);
+		stream.write<uint16_t>(item->getUniqueId());
+	}
+
+	if (door) {
+		stream.write<uint8_t>(ATTR_HOUSEDOORID);
+		stream.write<uint8_t>(door->getDoorId());
+	}
+
+	const Container* container = item->getContainer();
+	if (container) {
+		if (const DepotLocker* depotLocker = container->getDepotLocker()) {
+			stream.write<uint8_t>(ATTR_DEPOT_ID);
+			stream.write<uint16_t>(depotLocker->getDepotId());
+		}
+
+		stream.write<uint8_t>(ATTR_CONTAINER_ITEMS);
+		stream.write<uint32_t>(container->size());
+		for (auto it = container->getReversedItems(), end = container->getReversedEnd(); it != end; ++it) {
+			saveSnapshotItem(stream, *it);
+		}
+	}
+
+	stream.write<uint8_t>(0x00); // attr end
+}
+
+}
+
+bool IOMap::buildTileArea(OTB::Loader* loader, DecodedTileArea& area, Map& map)
+{
+	uint16_t z = area.z;
+
+	if (snapshotTiles) {
+		snapshotTiles->write<uint8_t>(area.z);
+		snapshotTiles->write<uint32_t>(area.tiles.size());
+		++snapshotAreas;
+	}
+
+	for (DecodedTile& decodedTile : area.tiles) {
+		uint16_t x = decodedTile.x;
+		uint16_t y = decodedTile.y;
+
+		if (snapshotTiles) {
+			snapshotTiles->write<uint16_t>(x);
+			snapshotTiles->write<uint16_t>(y);
+			snapshotTiles->write<uint32_t>(decodedTile.flags);
+			snapshotTiles->write<uint8_t>(decodedTile.isHouseTile ? 1 : 0);
+			snapshotTiles->write<uint32_t>(decodedTile.houseId);
+			snapshotTiles->write<uint32_t>(decodedTile.items.size());
+		}
+
+		for (const auto& it : decodedTile.uniqueIds) {
+			it.first->setUniqueId(it.second);
+		}
+
+		bool isHouseTile = decodedTile.isHouseTile;
+		House* house = nullptr;
+		Tile* tile = nullptr;
+		Item* ground_item = nullptr;
+
+		if (isHouseTile) {
+			house = map.houses.addHouse(decodedTile.houseId);
+			if (!house) {
+				std::ostringstream ss;
+				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << decodedTile.houseId;
+				setLastErrorString(ss.str());
+				return false;
+			}
+
+			tile = new HouseTile(x, y, z, house);
+			house->addTile(static_cast<HouseTile*>(tile));
+		}
+
+		for (auto& it : decodedTile.items) {
+			Item* item = it.first;
+			// the area owns whatever is left in the list if we bail out
+			it.first = nullptr;
+
+			if (it.second) {
+				PropStream stream;
+				if (!loader || !loader->getProps(*it.second, stream) || !stream.skip(sizeof(uint16_t)) || !item->unserializeItemNode(*loader, *it.second, stream)) {
+					std::ostringstream ss;
+					ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
+					setLastErrorString(ss.str());
+					delete item;
+					delete ground_item;
+					return false;
+				}
+			}
+
+			if (snapshotTiles) {
+				saveSnapshotItem(*snapshotTiles, item);
+			}
+
 			if (isHouseTile && item->isMoveable()) {
 				std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
 				delete item;
@@ -396,13 +652,222 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			tile = createTile(ground_item, nullptr, x, y, z);
 		}
 
-		tile->setFlag(static_cast<tileflags_t>(tileflags));
+		tile->setFlag(static_cast<tileflags_t>(decodedTile.flags));
 
 		map.setTile(x, y, z, tile);
 	}
 	return true;
 }
 
+uint64_t IOMap::getSnapshotSourceHash(const std::string& fileName)
+{
+	// FNV-1a over everything the decoded tiles depend on
+	uint64_t hash = 14695981039346656037ULL;
+	for (const std::string& sourceFile : {fileName, std::string("data/items/items.otb"), std::string("data/items/items.xml")}) {
+		try {
+			OTB::MappedFile source(sourceFile);
+			for (char byte : source) {
+				hash ^= static_cast<uint8_t>(byte);
+				hash *= 1099511628211ULL;
+			}
+		} catch (const std::exception&) {
+			return 0;
+		}
+	}
+	return hash;
+}
+
+SnapshotStatus_t IOMap::loadSnapshot(Map& map, const std::string& snapshotFile, uint64_t sourceHash)
+{
+	if (sourceHash == 0) {
+		return SNAPSHOT_STALE;
+	}
+
+	OTB::MappedFile snapshot;
+	try {
+		snapshot.open(snapshotFile);
+	} catch (const std::exception&) {
+		return SNAPSHOT_STALE;
+	}
+
+	PropStream propStream;
+	propStream.init(snapshot.data(), snapshot.size());
+
+	char identifier[4];
+	uint16_t version;
+	uint64_t snapshotHash;
+	if (!propStream.read(identifier) || std::string(identifier, 4) != "TFSM" || !propStream.read<uint16_t>(version) || version != SNAPSHOT_VERSION
+	        || !propStream.read<uint64_t>(snapshotHash) || snapshotHash != sourceHash) {
+		return SNAPSHOT_STALE;
+	}
+
+	// from here on the snapshot belongs to our map, anything unreadable is an error
+	setLastErrorString("Corrupt map snapshot " + snapshotFile + ", delete it to rebuild it.");
+
+	uint16_t width, height;
+	if (!propStream.read<uint16_t>(width) || !propStream.read<uint16_t>(height)
+	        || !propStream.readString(map.spawnfile) || !propStream.readString(map.housefile)) {
+		return SNAPSHOT_INVALID;
+	}
+
+	std::cout << "> Map size: " << width << "x" << height << '.' << std::endl;
+	map.width = width;
+	map.height = height;
+
+	uint32_t townCount;
+	if (!propStream.read<uint32_t>(townCount)) {
+		return SNAPSHOT_INVALID;
+	}
+
+	for (uint32_t i = 0; i < townCount; ++i) {
+		uint32_t townId;
+		std::string townName;
+		OTBM_Destination_coords town_coords;
+		if (!propStream.read<uint32_t>(townId) || !propStream.readString(townName) || !propStream.read(town_coords)) {
+			return SNAPSHOT_INVALID;
+		}
+
+		Town* town = map.towns.getTown(townId);
+		if (!town) {
+			town = new Town(townId);
+			map.towns.addTown(townId, town);
+		}
+
+		town->setName(townName);
+		town->setTemplePos(Position(town_coords.x, town_coords.y, town_coords.z));
+	}
+
+	uint32_t waypointCount;
+	if (!propStream.read<uint32_t>(waypointCount)) {
+		return SNAPSHOT_INVALID;
+	}
+
+	for (uint32_t i = 0; i < waypointCount; ++i) {
+		std::string name;
+		OTBM_Destination_coords waypoint_coords;
+		if (!propStream.readString(name) || !propStream.read(waypoint_coords)) {
+			return SNAPSHOT_INVALID;
+		}
+		map.waypoints[name] = Position(waypoint_coords.x, waypoint_coords.y, waypoint_coords.z);
+	}
+
+	uint32_t areaCount;
+	if (!propStream.read<uint32_t>(areaCount)) {
+		return SNAPSHOT_INVALID;
+	}
+
+	for (uint32_t i = 0; i < areaCount; ++i) {
+		DecodedTileArea area;
+		uint32_t tileCount;
+		if (!propStream.read<uint8_t>(area.z) || !propStream.read<uint32_t>(tileCount)) {
+			return SNAPSHOT_INVALID;
+		}
+
+		area.tiles.reserve(tileCount);
+		for (uint32_t j = 0; j < tileCount; ++j) {
+			area.tiles.emplace_back();
+			DecodedTile& tile = area.tiles.back();
+
+			uint8_t isHouseTile;
+			uint32_t itemCount;
+			if (!propStream.read<uint16_t>(tile.x) || !propStream.read<uint16_t>(tile.y) || !propStream.read<uint32_t>(tile.flags)
+			        || !propStream.read<uint8_t>(isHouseTile) || !propStream.read<uint32_t>(tile.houseId) || !propStream.read<uint32_t>(itemCount)) {
+				return SNAPSHOT_INVALID;
+			}
+			tile.isHouseTile = isHouseTile != 0;
+
+			for (uint32_t k = 0; k < itemCount; ++k) {
+				uint16_t id;
+				if (!propStream.read<uint16_t>(id)) {
+					return SNAPSHOT_INVALID;
+				}
+
+				Item* item = Item::CreateItem(id);
+				if (!item) {
+					return SNAPSHOT_INVALID;
+				}
+
+				tile.items.emplace_back(item, nullptr);
+				if (!item->unserializeAttr(propStream)) {
+					return SNAPSHOT_INVALID;
+				}
+
+				Container* container = item->getContainer();
+				if (container && !IOMapSerialize::loadContainer(propStream, container)) {
+					return SNAPSHOT_INVALID;
+				}
+			}
+		}
+
+		if (!buildTileArea(nullptr, area, map)) {
+			return SNAPSHOT_INVALID;
+		}
+	}
+
+	setLastErrorString("");
+	return SNAPSHOT_LOADED;
+}
+
+bool IOMap::saveSnapshot(const Map& map, const std::string& snapshotFile, uint64_t sourceHash) const
+{
+	if (sourceHash == 0) {
+		return false;
+	}
+
+	PropWriteStream header;
+	for (char c : {'T', 'F', 'S', 'M'}) {
+		header.write<char>(c);
+	}
+	header.write<uint16_t>(SNAPSHOT_VERSION);
+	header.write<uint64_t>(sourceHash);
+
+	header.write<uint16_t>(map.width);
+	header.write<uint16_t>(map.height);
+	header.writeString(map.spawnfile);
+	header.writeString(map.housefile);
+
+	const TownMap& towns = map.towns.getTowns();
+	header.write<uint32_t>(towns.size());
+	for (const auto& it : towns) {
+		const Town* town = it.second;
+		const Position& templePos = town->getTemplePosition();
+		header.write<uint32_t>(town->getID());
+		header.writeString(town->getName());
+		header.write<uint16_t>(templePos.x);
+		header.write<uint16_t>(templePos.y);
+		header.write<uint8_t>(templePos.z);
+	}
+
+	header.write<uint32_t>(map.waypoints.size());
+	for (const auto& it : map.waypoints) {
+		header.writeString(it.first);
+		header.write<uint16_t>(it.second.x);
+		header.write<uint16_t>(it.second.y);
+		header.write<uint8_t>(it.second.z);
+	}
+
+	header.write<uint32_t>(snapshotAreas);
+
+	std::ofstream file(snapshotFile, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cout << "[Warning - IOMap::saveSnapshot] Could not open " << snapshotFile << " for writing." << std::endl;
+		return false;
+	}
+
+	size_t size;
+	const char* data = header.getStream(size);
+	file.write(data, size);
+	data = snapshotTiles->getStream(size);
+	file.write(data, size);
+	if (!file) {
+		std::cout << "[Warning - IOMap::saveSnapshot] Could not write " << snapshotFile << '.' << std::endl;
+		return false;
+	}
+
+	std::cout << "> Saved map snapshot " << snapshotFile << '.' << std::endl;
+	return true;
+}
+
 bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map)
 {
 	for (auto& townNode : townsNode.children) {
@@ -102,6 +102,24 @@ struct OTBM_Tile_coords {
 
 #pragma pack()
 
+static constexpr uint16_t SNAPSHOT_VERSION = 1;
+
+struct MapLoadStats {
+	// milliseconds spent per loading phase
+	int64_t treeTime = 0;
+	int64_t decodeTime = 0;
+	int64_t buildTime = 0;
+	uint32_t threads = 1;
+};
+
+struct DecodedTileArea;
+
+enum SnapshotStatus_t {
+	SNAPSHOT_STALE,
+	SNAPSHOT_LOADED,
+	SNAPSHOT_INVALID,
+};
+
 class IOMap
 {
 	static Tile* createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8_t z);
@@ -151,8 +169,24 @@ class IOMap
 		bool parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName);
 		bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
 		bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
-		bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map);
+		bool loadTileAreas(OTB::Loader& loader, std::vector<DecodedTileArea>& areas, Map& map);
+		static bool decodeTileArea(OTB::Loader& loader, DecodedTileArea& area);
+		bool buildTileArea(OTB::Loader* loader, DecodedTileArea& area, Map& map);
+
+		/* The compiled map snapshot holds the decoded tiles, towns and waypoints of
+		 * a map file and is only used while the map, items.otb and items.xml it was
+		 * built from are unchanged
+		 */
+		static uint64_t getSnapshotSourceHash(const std::string& fileName);
+		SnapshotStatus_t loadSnapshot(Map& map, const std::string& snapshotFile, uint64_t sourceHash);
+		bool saveSnapshot(const Map& map, const std::string& snapshotFile, uint64_t sourceHash) const;
+
 		std::string errorString;
+		MapLoadStats loadStats;
+
+		// tile records written while building, set when a snapshot is to be saved
+		std::unique_ptr<PropWriteStream> snapshotTiles;
+		uint32_t snapshotAreas = 0;
 };
 
 #endif
@@ -37,6 +37,8 @@ class IOMapSerialize
 
 		static bool loadContainer(PropStream& propStream, Container* container);
 		static bool loadItem(PropStream& propStream, Cylinder* parent);
+
+		friend class IOMap;
 };
 
 #endif
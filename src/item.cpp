@@ -36,6 +36,7 @@ extern Spells* g_spells;
 extern Vocations g_vocations;
 
 Items Item::items;
+thread_local Item::UniqueIdList* Item::uniqueIdCollector = nullptr;
 
 Item* Item::CreateItem(const uint16_t type, uint16_t count /*= 0*/)
 {
@@ -393,7 +394,11 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 				return ATTR_READ_ERROR;
 			}
 
-			setUniqueId(uniqueId);
+			if (uniqueIdCollector) {
+				uniqueIdCollector->emplace_back(this, uniqueId);
+			} else {
+				setUniqueId(uniqueId);
+			}
 			break;
 		}
 
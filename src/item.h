@@ -306,6 +306,12 @@ class Item : virtual public Thing
 		static Item* CreateItem(PropStream& propStream);
 		static Items items;
 
+		// unique ids read while a list is set are collected there for the owning thread to register later
+		using UniqueIdList = std::vector<std::pair<Item*, uint16_t>>;
+		static void setUniqueIdCollector(UniqueIdList* list) {
+			uniqueIdCollector = list;
+		}
+
 		// Constructor for items
 		Item(const uint16_t type, uint16_t count = 0);
 		Item(const Item& i);
@@ -758,6 +764,8 @@ class Item : virtual public Thing
 
 		bool loadedFromMap = false;
 
+		static thread_local UniqueIdList* uniqueIdCollector;
+
 		//Don't add variables here, use the ItemAttribute class.
 };
 
@@ -24,12 +24,15 @@
 #define _ENABLE_ATOMIC_ALIGNMENT_FIX
 #endif
 
+#include <atomic>
+
 #include <boost/lockfree/stack.hpp>
 
 template <typename T, size_t CAPACITY>
 class LockfreePoolingAllocator : public std::allocator<T>
 {
 	public:
+		LockfreePoolingAllocator() = default;
 		template <typename U>
 		explicit constexpr LockfreePoolingAllocator(const U&) {}
 		using value_type = T;
@@ -59,4 +62,57 @@ class LockfreePoolingAllocator : public std::allocator<T>
 		}
 };
 
+/**
+ * Unbounded multi-producer single-consumer queue of intrusively linked
+ * nodes, T::*Next is the link used by the queue. Producers push onto a
+ * lock-free stack, the consumer takes everything pushed so far in one
+ * atomic exchange and gets it back oldest first, so draining is always
+ * done in batches and pushing never allocates.
+ */
+template <typename T, T* T::*Next>
+class LockfreeBatchQueue
+{
+	public:
+		void push(T* node) {
+			T* oldHead = head.load(std::memory_order_relaxed);
+			do {
+				node->*Next = oldHead;
+			} while (!head.compare_exchange_weak(oldHead, node));
+		}
+
+		// pushes a chain already linked through T::*Next from first to last with
+		// a single exchange, first is the node to be drained last
+		void pushChain(T* first, T* last) {
+			T* oldHead = head.load(std::memory_order_relaxed);
+			do {
+				last->*Next = oldHead;
+			} while (!head.compare_exchange_weak(oldHead, first));
+		}
+
+		// returns a chain linked through T::*Next, concurrent drains each get
+		// their own nodes but only the consumer should rely on the order
+		T* drain() {
+			if (empty()) {
+				return nullptr;
+			}
+
+			T* node = head.exchange(nullptr);
+			T* reversed = nullptr;
+			while (node) {
+				T* next = node->*Next;
+				node->*Next = reversed;
+				reversed = node;
+				node = next;
+			}
+			return reversed;
+		}
+
+		bool empty() const {
+			return head.load() == nullptr;
+		}
+
+	private:
+		std::atomic<T*> head {nullptr};
+};
+
 #endif
@@ -280,6 +280,8 @@ bool LuaScriptInterface::reInitState()
 /// Same as lua_pcall, but adds stack trace to error strings in called function.
 int LuaScriptInterface::protectedCall(lua_State* L, int nargs, int nresults)
 {
+	DispatcherTickScope tickScope(TICK_CATEGORY_LUA);
+
 	int error_index = lua_gettop(L) - nargs;
 	lua_pushcfunction(L, luaErrorHandler);
 	lua_insert(L, error_index);
@@ -600,6 +602,19 @@ void LuaScriptInterface::pushCylinder(lua_State* L, Cylinder* cylinder)
 	}
 }
 
+void LuaScriptInterface::pushCreaturesInArea(lua_State* L, const SpatialArea& area, SpatialFilter_t filter)
+{
+	lua_newtable(L);
+
+	int index = 0;
+	g_game.map.queryCreatures(area, filter, [L, &index](Creature* creature) {
+		pushUserdata<Creature>(L, creature);
+		setCreatureMetatable(L, -1, creature);
+		lua_rawseti(L, -2, ++index);
+		return true;
+	});
+}
+
 void LuaScriptInterface::pushString(lua_State* L, const std::string& value)
 {
 	lua_pushlstring(L, value.c_str(), value.length());
@@ -1602,6 +1617,12 @@ void LuaScriptInterface::registerFunctions()
 	registerEnum(TILESTATE_FLOORCHANGE_SOUTH_ALT)
 	registerEnum(TILESTATE_FLOORCHANGE_EAST_ALT)
 	registerEnum(TILESTATE_SUPPORTS_HANGABLE)
+	registerEnum(TILESTATE_BLOCKPROJECTILE)
+
+	registerEnum(SPATIALFILTER_ALL)
+	registerEnum(SPATIALFILTER_PLAYERS)
+	registerEnum(SPATIALFILTER_MONSTERS)
+	registerEnum(SPATIALFILTER_NPCS)
 
 	registerEnum(WEAPON_NONE)
 	registerEnum(WEAPON_SWORD)
@@ -1625,6 +1646,7 @@ void LuaScriptInterface::registerFunctions()
 	registerEnum(FLAG_IGNOREFIELDDAMAGE)
 	registerEnum(FLAG_IGNORENOTMOVEABLE)
 	registerEnum(FLAG_IGNOREAUTOSTACK)
+	registerEnum(FLAG_IGNOREMAGICFIELD)
 
 	// Use with itemType:getSlotPosition
 	registerEnum(SLOTP_WHEREEVER)
@@ -1857,6 +1879,8 @@ void LuaScriptInterface::registerFunctions()
 	registerTable("Game");
 
 	registerMethod("Game", "getSpectators", LuaScriptInterface::luaGameGetSpectators);
+	registerMethod("Game", "getCreaturesInArea", LuaScriptInterface::luaGameGetCreaturesInArea);
+	registerMethod("Game", "getCreaturesInRadius", LuaScriptInterface::luaGameGetCreaturesInRadius);
 	registerMethod("Game", "getPlayers", LuaScriptInterface::luaGameGetPlayers);
 	registerMethod("Game", "loadMap", LuaScriptInterface::luaGameLoadMap);
 
@@ -3483,7 +3507,7 @@ int LuaScriptInterface::luaAddEvent(lua_State* L)
 
 	auto& lastTimerEventId = g_luaEnvironment.lastEventTimerId;
 	eventDesc.eventId = g_scheduler.addEvent(createSchedulerTask(
-		delay, std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId)
+		delay, "LuaEnvironment::executeTimerEvent", std::bind(&LuaEnvironment::executeTimerEvent, &g_luaEnvironment, lastTimerEventId)
 	));
 
 	g_luaEnvironment.timerEvents.emplace(lastTimerEventId, std::move(eventDesc));
@@ -3961,17 +3985,57 @@ int LuaScriptInterface::luaGameGetSpectators(lua_State* L)
 	int32_t minRangeY = getNumber<int32_t>(L, 6, 0);
 	int32_t maxRangeY = getNumber<int32_t>(L, 7, 0);
 
-	SpectatorHashSet spectators;
-	g_game.map.getSpectators(spectators, position, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
+	if (multifloor && minRangeX == 0 && maxRangeX == 0 && minRangeY == 0 && maxRangeY == 0) {
+		// the full viewport is served from the spectator cache
+		SpectatorVec spectators;
+		g_game.map.getSpectators(spectators, position, true, onlyPlayers);
 
-	lua_createtable(L, spectators.size(), 0);
+		lua_createtable(L, spectators.size(), 0);
 
-	int index = 0;
-	for (Creature* creature : spectators) {
-		pushUserdata<Creature>(L, creature);
-		setCreatureMetatable(L, -1, creature);
-		lua_rawseti(L, -2, ++index);
+		int index = 0;
+		for (Creature* creature : spectators) {
+			pushUserdata<Creature>(L, creature);
+			setCreatureMetatable(L, -1, creature);
+			lua_rawseti(L, -2, ++index);
+		}
+		return 1;
+	}
+
+	minRangeX = (minRangeX == 0 ? -Map::maxViewportX : -minRangeX);
+	maxRangeX = (maxRangeX == 0 ? Map::maxViewportX : maxRangeX);
+	minRangeY = (minRangeY == 0 ? -Map::maxViewportY : -minRangeY);
+	maxRangeY = (maxRangeY == 0 ? Map::maxViewportY : maxRangeY);
+
+	SpatialArea area;
+	if (multifloor) {
+		area = SpatialArea::visibleFrom(position, minRangeX, maxRangeX, minRangeY, maxRangeY);
+	} else {
+		area = SpatialArea::viewport(position, minRangeX, maxRangeX, minRangeY, maxRangeY, position.z, position.z);
 	}
+
+	pushCreaturesInArea(L, area, onlyPlayers ? SPATIALFILTER_PLAYERS : SPATIALFILTER_ALL);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetCreaturesInArea(lua_State* L)
+{
+	// Game.getCreaturesInArea(fromPosition, toPosition[, filter = SPATIALFILTER_ALL])
+	const Position& fromPosition = getPosition(L, 1);
+	const Position& toPosition = getPosition(L, 2);
+	SpatialFilter_t filter = getNumber<SpatialFilter_t>(L, 3, SPATIALFILTER_ALL);
+
+	pushCreaturesInArea(L, SpatialArea::box(fromPosition, toPosition), filter);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetCreaturesInRadius(lua_State* L)
+{
+	// Game.getCreaturesInRadius(position, radius[, filter = SPATIALFILTER_ALL])
+	const Position& position = getPosition(L, 1);
+	int32_t radius = getNumber<int32_t>(L, 2);
+	SpatialFilter_t filter = getNumber<SpatialFilter_t>(L, 3, SPATIALFILTER_ALL);
+
+	pushCreaturesInArea(L, SpatialArea::circle(position, radius), filter);
 	return 1;
 }
 
@@ -3993,7 +4057,7 @@ int LuaScriptInterface::luaGameLoadMap(lua_State* L)
 {
 	// Game.loadMap(path)
 	const std::string& path = getString(L, 1);
-	g_dispatcher.addTask(createTask(std::bind(&Game::loadMap, &g_game, path)));
+	g_dispatcher.addTask(createTask("Game::loadMap", std::bind(&Game::loadMap, &g_game, path)));
 	return 0;
 }
 
@@ -4465,11 +4529,11 @@ int LuaScriptInterface::luaPositionIsSightClear(lua_State* L)
 int LuaScriptInterface::luaPositionSendMagicEffect(lua_State* L)
 {
 	// position:sendMagicEffect(magicEffect[, player = nullptr])
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	if (lua_gettop(L) >= 3) {
 		Player* player = getPlayer(L, 3);
 		if (player) {
-			spectators.insert(player);
+			spectators.emplace_back(player);
 		}
 	}
 
@@ -4488,11 +4552,11 @@ int LuaScriptInterface::luaPositionSendMagicEffect(lua_State* L)
 int LuaScriptInterface::luaPositionSendDistanceEffect(lua_State* L)
 {
 	// position:sendDistanceEffect(positionEx, distanceEffect[, player = nullptr])
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	if (lua_gettop(L) >= 4) {
 		Player* player = getPlayer(L, 4);
 		if (player) {
-			spectators.insert(player);
+			spectators.emplace_back(player);
 		}
 	}
 
@@ -7257,9 +7321,9 @@ int LuaScriptInterface::luaCreatureSay(lua_State* L)
 		return 1;
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	if (target) {
-		spectators.insert(target);
+		spectators.emplace_back(target);
 	}
 
 	if (position.x != 0) {
@@ -9225,7 +9289,7 @@ int LuaScriptInterface::luaPlayerSetGhostMode(lua_State* L)
 	Tile* tile = player->getTile();
 	const Position& position = player->getPosition();
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, true, true);
 	for (Creature* spectator : spectators) {
 		Player* tmpPlayer = spectator->getPlayer();
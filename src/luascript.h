@@ -47,6 +47,7 @@ class Condition;
 class Npc;
 class Monster;
 class InstantSpell;
+struct SpatialArea;
 
 enum {
 	EVENT_ID_LOADING = 1,
@@ -250,6 +251,7 @@ class LuaScriptInterface
 		static void pushString(lua_State* L, const std::string& value);
 		static void pushCallback(lua_State* L, int32_t callback);
 		static void pushCylinder(lua_State* L, Cylinder* cylinder);
+		static void pushCreaturesInArea(lua_State* L, const SpatialArea& area, SpatialFilter_t filter);
 
 		static std::string popString(lua_State* L);
 		static int32_t popCallback(lua_State* L);
@@ -514,6 +516,8 @@ class LuaScriptInterface
 
 		// Game
 		static int luaGameGetSpectators(lua_State* L);
+		static int luaGameGetCreaturesInArea(lua_State* L);
+		static int luaGameGetCreaturesInRadius(lua_State* L);
 		static int luaGameGetPlayers(lua_State* L);
 		static int luaGameLoadMap(lua_State* L);
 
@@ -74,24 +74,68 @@ bool Map::save()
 	return saved;
 }
 
-Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+Floor* Map::getFloor(uint16_t x, uint16_t y, uint8_t z) const
 {
 	if (z >= MAP_MAX_LAYERS) {
 		return nullptr;
 	}
 
-	const QTreeLeafNode* leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+	const QTreeLeafNode* leaf = getLeaf(x, y);
 	if (!leaf) {
 		return nullptr;
 	}
+	return leaf->getFloor(z);
+}
 
-	const Floor* floor = leaf->getFloor(z);
+Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+{
+	const Floor* floor = getFloor(x, y, z);
 	if (!floor) {
 		return nullptr;
 	}
 	return floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
 }
 
+void Map::updateTileBitmaps(const Tile& tile)
+{
+	const Position& pos = tile.getPosition();
+	Floor* floor = getFloor(pos.x, pos.y, pos.z);
+	if (!floor || floor->tiles[pos.x & FLOOR_MASK][pos.y & FLOOR_MASK] != &tile) {
+		// not on the map yet, setTile updates it once inserted
+		return;
+	}
+
+	const bool wasPathBlocked = floor->isPathBlocked(pos.x, pos.y);
+
+	const uint64_t bit = Floor::getTileBit(pos.x, pos.y);
+	if (tile.hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+		floor->blockProjectile |= bit;
+	} else {
+		floor->blockProjectile &= ~bit;
+	}
+
+	if (!tile.getGround() || tile.hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID)) {
+		floor->blockSolid |= bit;
+	} else {
+		floor->blockSolid &= ~bit;
+	}
+
+	if (tile.hasFlag(TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT)) {
+		floor->blockPath |= bit;
+	} else {
+		floor->blockPath &= ~bit;
+	}
+
+	if (floor->isPathBlocked(pos.x, pos.y) != wasPathBlocked) {
+		pathClusters.invalidate(pos);
+		for (auto& it : flowFields) {
+			if (it.second.covers(pos)) {
+				it.second.invalidate();
+			}
+		}
+	}
+}
+
 void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 {
 	if (z >= MAP_MAX_LAYERS) {
@@ -126,6 +170,8 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 		if (eastLeaf) {
 			leaf->leafE = eastLeaf;
 		}
+
+		addGridLeaf(x, y, leaf);
 	}
 
 	Floor* floor = leaf->createFloor(z);
@@ -151,6 +197,27 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	} else {
 		tile = newTile;
 	}
+	updateTileBitmaps(*tile);
+}
+
+void Map::addGridLeaf(uint16_t x, uint16_t y, QTreeLeafNode* leaf)
+{
+	if (tileChunks.empty()) {
+		// the map header has been read by now, tiles outside of its size stay QTree only
+		tileChunksX = (width + (1 << TILE_CHUNK_BITS) - 1) >> TILE_CHUNK_BITS;
+		tileChunksY = (height + (1 << TILE_CHUNK_BITS) - 1) >> TILE_CHUNK_BITS;
+		tileChunks.resize(tileChunksX * tileChunksY);
+	}
+
+	if (!isInTileGrid(x, y)) {
+		return;
+	}
+
+	std::unique_ptr<TileChunk>& chunk = tileChunks[(y >> TILE_CHUNK_BITS) * tileChunksX + (x >> TILE_CHUNK_BITS)];
+	if (!chunk) {
+		chunk.reset(new TileChunk());
+	}
+	chunk->leaves[(y >> FLOOR_BITS) & TILE_CHUNK_LEAF_MASK][(x >> FLOOR_BITS) & TILE_CHUNK_LEAF_MASK] = leaf;
 }
 
 bool Map::placeCreature(const Position& centerPos, Creature* creature, bool extendedPos/* = false*/, bool forceLogin/* = false*/)
@@ -221,7 +288,7 @@ bool Map::placeCreature(const Position& centerPos, Creature* creature, bool exte
 	toCylinder->internalAddThing(creature);
 
 	const Position& dest = toCylinder->getPosition();
-	getQTNode(dest.x, dest.y)->addCreature(creature);
+	getQTNode(dest.x, dest.y)->addCreature(creature, dest.z);
 	return true;
 }
 
@@ -234,7 +301,7 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 
 	bool teleport = forceTeleport || !newTile.getGround() || !Position::areInRange<1, 1, 0>(oldPos, newPos);
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	getSpectators(spectators, oldPos, true);
 	getSpectators(spectators, newPos, true);
 
@@ -255,10 +322,10 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 	QTreeLeafNode* leaf = getQTNode(oldPos.x, oldPos.y);
 	QTreeLeafNode* new_leaf = getQTNode(newPos.x, newPos.y);
 
-	// Switch the node ownership
-	if (leaf != new_leaf) {
-		leaf->removeCreature(&creature);
-		new_leaf->addCreature(&creature);
+	// Switch the node ownership, creatures are kept per floor
+	if (leaf != new_leaf || oldPos.z != newPos.z) {
+		leaf->removeCreature(&creature, oldPos.z);
+		new_leaf->addCreature(&creature, newPos.z);
 	}
 
 	//add the creature
@@ -299,69 +366,135 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 	newTile.postAddNotification(&creature, &oldTile, 0);
 }
 
-void Map::getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
+SpatialArea SpatialArea::box(const Position& fromPos, const Position& toPos)
 {
-	int_fast16_t min_y = centerPos.y + minRangeY;
-	int_fast16_t min_x = centerPos.x + minRangeX;
-	int_fast16_t max_y = centerPos.y + maxRangeY;
-	int_fast16_t max_x = centerPos.x + maxRangeX;
+	SpatialArea area;
+	area.minX = std::min(fromPos.x, toPos.x);
+	area.maxX = std::max(fromPos.x, toPos.x);
+	area.minY = std::min(fromPos.y, toPos.y);
+	area.maxY = std::max(fromPos.y, toPos.y);
+	area.minZ = std::min(fromPos.z, toPos.z);
+	area.maxZ = std::max(fromPos.z, toPos.z);
+	area.centerPos = fromPos;
+	return area;
+}
 
-	int32_t minoffset = centerPos.getZ() - maxRangeZ;
-	uint16_t x1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (min_x + minoffset)));
-	uint16_t y1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (min_y + minoffset)));
+SpatialArea SpatialArea::square(const Position& centerPos, int32_t radius, uint8_t minZ, uint8_t maxZ)
+{
+	SpatialArea area;
+	if (radius < 0) {
+		return area;
+	}
 
-	int32_t maxoffset = centerPos.getZ() - minRangeZ;
-	uint16_t x2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (max_x + maxoffset)));
-	uint16_t y2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (max_y + maxoffset)));
+	area.minX = centerPos.x - radius;
+	area.maxX = centerPos.x + radius;
+	area.minY = centerPos.y - radius;
+	area.maxY = centerPos.y + radius;
+	area.minZ = minZ;
+	area.maxZ = maxZ;
+	area.centerPos = centerPos;
+	return area;
+}
 
-	int32_t startx1 = x1 - (x1 % FLOOR_SIZE);
-	int32_t starty1 = y1 - (y1 % FLOOR_SIZE);
-	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
-	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
+SpatialArea SpatialArea::circle(const Position& centerPos, int32_t radius)
+{
+	return circle(centerPos, radius, centerPos.z, centerPos.z);
+}
 
-	const QTreeLeafNode* startLeaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, starty1);
-	const QTreeLeafNode* leafS = startLeaf;
-	const QTreeLeafNode* leafE;
+SpatialArea SpatialArea::circle(const Position& centerPos, int32_t radius, uint8_t minZ, uint8_t maxZ)
+{
+	SpatialArea area = square(centerPos, radius, minZ, maxZ);
+	if (radius >= 0) {
+		area.radius = radius;
+	}
+	return area;
+}
 
-	for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
-		leafE = leafS;
-		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
-			if (leafE) {
-				const CreatureVector& node_list = (onlyPlayers ? leafE->player_list : leafE->creature_list);
-				for (Creature* creature : node_list) {
-					const Position& cpos = creature->getPosition();
-					if (minRangeZ > cpos.z || maxRangeZ < cpos.z) {
-						continue;
-					}
+SpatialArea SpatialArea::viewport(const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minZ, int32_t maxZ)
+{
+	SpatialArea area;
+	area.minX = centerPos.x + minRangeX;
+	area.maxX = centerPos.x + maxRangeX;
+	area.minY = centerPos.y + minRangeY;
+	area.maxY = centerPos.y + maxRangeY;
+	area.minZ = minZ;
+	area.maxZ = maxZ;
+	area.centerPos = centerPos;
+	area.perspective = true;
+	return area;
+}
 
-					int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-					if ((min_y + offsetZ) > cpos.y || (max_y + offsetZ) < cpos.y || (min_x + offsetZ) > cpos.x || (max_x + offsetZ) < cpos.x) {
-						continue;
-					}
+void Map::getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
+{
+	const SpatialArea area = SpatialArea::viewport(centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ);
+	queryCreatures(area, onlyPlayers ? SPATIALFILTER_PLAYERS : SPATIALFILTER_ALL, [&spectators](Creature* creature) {
+		spectators.emplace_back(creature);
+		return true;
+	});
+}
 
-					spectators.insert(creature);
-				}
-				leafE = leafE->leafE;
-			} else {
-				leafE = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, nx + FLOOR_SIZE, ny);
-			}
-		}
+namespace {
 
-		if (leafS) {
-			leafS = leafS->leafS;
-		} else {
-			leafS = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, ny + FLOOR_SIZE);
-		}
+constexpr int32_t SPECTATOR_CACHE_SECTOR_BITS = 5;
+constexpr size_t MAX_SPECTATOR_CACHE_ENTRIES = 1 << 16;
+// floors 0 to 7 see each other, a floor further away shifts the view by one tile
+constexpr int32_t MAX_SPECTATOR_FLOOR_OFFSET = 7;
+
+uint32_t getSpectatorCacheSector(int32_t x, int32_t y)
+{
+	return (static_cast<uint32_t>(x >> SPECTATOR_CACHE_SECTOR_BITS) << 16) | static_cast<uint32_t>(y >> SPECTATOR_CACHE_SECTOR_BITS);
+}
+
+void getSpectatorFloors(const Position& centerPos, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+	if (centerPos.z > 7) {
+		//underground
+
+		//8->15
+		minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+		maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
+	} else if (centerPos.z == 6) {
+		minRangeZ = 0;
+		maxRangeZ = 8;
+	} else if (centerPos.z == 7) {
+		minRangeZ = 0;
+		maxRangeZ = 9;
+	} else {
+		minRangeZ = 0;
+		maxRangeZ = 7;
 	}
 }
 
-void Map::getSpectators(SpectatorHashSet& spectators, const Position& centerPos, bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
+// whether a creature on pos is part of the cached (full viewport, multifloor) spectators of centerPos
+bool isInSpectatorArea(const Position& centerPos, const Position& pos)
+{
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
+	if (minRangeZ > pos.z || maxRangeZ < pos.z) {
+		return false;
+	}
+
+	int32_t offsetZ = Position::getOffsetZ(centerPos, pos);
+	return std::abs(pos.getX() - centerPos.getX() - offsetZ) <= Map::maxViewportX && std::abs(pos.getY() - centerPos.getY() - offsetZ) <= Map::maxViewportY;
+}
+
+}
+
+SpatialArea SpatialArea::visibleFrom(const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY)
+{
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
+	return viewport(centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ);
+}
+
+void Map::getSpectators(SpectatorVec& spectators, const Position& centerPos, bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
 {
 	if (centerPos.z >= MAP_MAX_LAYERS) {
 		return;
 	}
 
-	bool foundCache = false;
 	bool cacheResult = false;
 
 	minRangeX = (minRangeX == 0 ? -maxViewportX : -minRangeX);
@@ -370,79 +503,112 @@ void Map::getSpectators(SpectatorHashSet& spectators, const Position& centerPos,
 	maxRangeY = (maxRangeY == 0 ? maxViewportY : maxRangeY);
 
 	if (minRangeX == -maxViewportX && maxRangeX == maxViewportX && minRangeY == -maxViewportY && maxRangeY == maxViewportY && multifloor) {
-		if (onlyPlayers) {
-			auto it = playersSpectatorCache.find(centerPos);
-			if (it != playersSpectatorCache.end()) {
-				if (!spectators.empty()) {
-					const SpectatorHashSet& cachedSpectators = it->second;
-					spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
-				} else {
-					spectators = it->second;
+		auto it = spectatorCache.find(getSpectatorCacheKey(centerPos));
+		if (it != spectatorCache.end()) {
+			SpectatorCacheEntry& entry = it->second;
+			if (onlyPlayers && !entry.hasPlayers && entry.hasSpectators) {
+				// the players are a subset of the cached creatures, keep them apart for the next lookup
+				for (Creature* spectator : entry.spectators) {
+					if (spectator->getPlayer()) {
+						entry.players.emplace_back(spectator);
+					}
 				}
+				entry.hasPlayers = true;
+			}
 
-				foundCache = true;
+			if (onlyPlayers ? entry.hasPlayers : entry.hasSpectators) {
+				spectators.addSpectators(onlyPlayers ? entry.players : entry.spectators);
+				++spectatorCacheStats.hits;
+				return;
 			}
 		}
 
-		if (!foundCache) {
-			auto it = spectatorCache.find(centerPos);
-			if (it != spectatorCache.end()) {
-				if (!onlyPlayers) {
-					if (!spectators.empty()) {
-						const SpectatorHashSet& cachedSpectators = it->second;
-						spectators.insert(cachedSpectators.begin(), cachedSpectators.end());
-					} else {
-						spectators = it->second;
-					}
-				} else {
-					const SpectatorHashSet& cachedSpectators = it->second;
-					for (Creature* spectator : cachedSpectators) {
-						if (spectator->getPlayer()) {
-							spectators.insert(spectator);
-						}
-					}
-				}
+		++spectatorCacheStats.misses;
+		cacheResult = true;
+	}
 
-				foundCache = true;
-			} else {
-				cacheResult = true;
-			}
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+
+	if (multifloor) {
+		getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
+	} else {
+		minRangeZ = centerPos.z;
+		maxRangeZ = centerPos.z;
+	}
+
+	if (!cacheResult) {
+		if (spectators.empty()) {
+			getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+		} else {
+			SpectatorVec found;
+			getSpectatorsInternal(found, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+			spectators.addSpectators(found);
 		}
+		return;
+	}
+
+	// the cached list must hold the spectators of centerPos only, callers may pass in a non-empty set
+	SpectatorCacheEntry& entry = getSpectatorCacheEntry(centerPos);
+	SpectatorVec& cachedSpectators = (onlyPlayers ? entry.players : entry.spectators);
+	getSpectatorsInternal(cachedSpectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+	if (onlyPlayers) {
+		entry.hasPlayers = true;
+	} else {
+		entry.hasSpectators = true;
 	}
+	spectators.addSpectators(cachedSpectators);
+}
 
-	if (!foundCache) {
-		int32_t minRangeZ;
-		int32_t maxRangeZ;
+SpectatorCacheEntry& Map::getSpectatorCacheEntry(const Position& centerPos)
+{
+	if (spectatorCache.size() >= MAX_SPECTATOR_CACHE_ENTRIES) {
+		clearSpectatorCache();
+		++spectatorCacheStats.flushes;
+	}
 
-		if (multifloor) {
-			if (centerPos.z > 7) {
-				//underground
+	auto result = spectatorCache.emplace(getSpectatorCacheKey(centerPos), SpectatorCacheEntry());
+	if (result.second) {
+		spectatorCacheSectors[getSpectatorCacheSector(centerPos.x, centerPos.y)].push_back(centerPos);
+	}
+	return result.first->second;
+}
 
-				//8->15
-				minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-				maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-			} else if (centerPos.z == 6) {
-				minRangeZ = 0;
-				maxRangeZ = 8;
-			} else if (centerPos.z == 7) {
-				minRangeZ = 0;
-				maxRangeZ = 9;
-			} else {
-				minRangeZ = 0;
-				maxRangeZ = 7;
+void Map::invalidateSpectatorCache(const Position& pos)
+{
+	if (spectatorCache.empty()) {
+		return;
+	}
+
+	static constexpr int32_t reachX = maxViewportX + MAX_SPECTATOR_FLOOR_OFFSET;
+	static constexpr int32_t reachY = maxViewportY + MAX_SPECTATOR_FLOOR_OFFSET;
+
+	int32_t startX = std::max<int32_t>(0, pos.getX() - reachX) >> SPECTATOR_CACHE_SECTOR_BITS;
+	int32_t startY = std::max<int32_t>(0, pos.getY() - reachY) >> SPECTATOR_CACHE_SECTOR_BITS;
+	int32_t endX = std::min<int32_t>(0xFFFF, pos.getX() + reachX) >> SPECTATOR_CACHE_SECTOR_BITS;
+	int32_t endY = std::min<int32_t>(0xFFFF, pos.getY() + reachY) >> SPECTATOR_CACHE_SECTOR_BITS;
+
+	for (int32_t sectorY = startY; sectorY <= endY; ++sectorY) {
+		for (int32_t sectorX = startX; sectorX <= endX; ++sectorX) {
+			auto it = spectatorCacheSectors.find(getSpectatorCacheSector(sectorX << SPECTATOR_CACHE_SECTOR_BITS, sectorY << SPECTATOR_CACHE_SECTOR_BITS));
+			if (it == spectatorCacheSectors.end()) {
+				continue;
 			}
-		} else {
-			minRangeZ = centerPos.z;
-			maxRangeZ = centerPos.z;
-		}
 
-		getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+			std::vector<Position>& centers = it->second;
+			for (size_t i = 0; i < centers.size();) {
+				if (isInSpectatorArea(centers[i], pos)) {
+					spectatorCache.erase(getSpectatorCacheKey(centers[i]));
+					centers[i] = centers.back();
+					centers.pop_back();
+					++spectatorCacheStats.invalidated;
+				} else {
+					++i;
+				}
+			}
 
-		if (cacheResult) {
-			if (onlyPlayers) {
-				playersSpectatorCache[centerPos] = spectators;
-			} else {
-				spectatorCache[centerPos] = spectators;
+			if (centers.empty()) {
+				spectatorCacheSectors.erase(it);
 			}
 		}
 	}
@@ -451,7 +617,21 @@ void Map::getSpectators(SpectatorHashSet& spectators, const Position& centerPos,
 void Map::clearSpectatorCache()
 {
 	spectatorCache.clear();
-	playersSpectatorCache.clear();
+	spectatorCacheSectors.clear();
+}
+
+void Map::reportSpectatorCacheStats()
+{
+	SpectatorCacheStats stats = takeSpectatorCacheStats();
+	uint64_t lookups = stats.hits + stats.misses;
+	if (lookups == 0) {
+		return;
+	}
+
+	std::cout << ">> Spectator cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+	          << std::fixed << std::setprecision(1) << (stats.hits * 100.) / lookups << "% hit rate), "
+	          << stats.invalidated << " entries invalidated, " << stats.flushes << " flushes, "
+	          << spectatorCache.size() << " cached." << std::endl;
 }
 
 bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight /*= true*/,
@@ -513,8 +693,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 			start.x += mx;
 		}
 
-		const Tile* tile = getTile(start.x, start.y, start.z);
-		if (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		if (isProjectileBlocked(start.x, start.y, start.z)) {
 			return false;
 		}
 	}
@@ -552,15 +731,48 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 	}
 
 	//used for non-cached tiles
-	Tile* tile = getTile(pos.x, pos.y, pos.z);
+	const Floor* floor = getFloor(pos.x, pos.y, pos.z);
+	if (!floor) {
+		return nullptr;
+	}
+
+	Tile* tile = floor->tiles[pos.x & FLOOR_MASK][pos.y & FLOOR_MASK];
 	if (creature.getTile() != tile) {
-		if (!tile || tile->queryAdd(0, creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) != RETURNVALUE_NOERROR) {
+		if (!tile || floor->isPathBlocked(pos.x, pos.y) || tile->queryAdd(0, creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) != RETURNVALUE_NOERROR) {
 			return nullptr;
 		}
 	}
 	return tile;
 }
 
+uint32_t Map::getPathingRevision(const Position& fromPos, const Position& toPos) const
+{
+	const int32_t startX = fromPos.getX() & ~FLOOR_MASK;
+	const int32_t startY = fromPos.getY() & ~FLOOR_MASK;
+	const int32_t endX = toPos.getX();
+	const int32_t endY = toPos.getY();
+
+	// leaf revisions only ever grow, so their sum changes as soon as one of them does
+	uint32_t revision = 0;
+	for (int32_t y = startY; y <= endY; y += FLOOR_SIZE) {
+		for (int32_t x = startX; x <= endX; x += FLOOR_SIZE) {
+			const QTreeLeafNode* leaf = getLeaf(x, y);
+			if (leaf) {
+				revision += leaf->pathingRevision;
+			}
+		}
+	}
+	return revision;
+}
+
+void Map::invalidatePathing(const Position& pos)
+{
+	QTreeLeafNode* leaf = getQTNode(pos.x, pos.y);
+	if (leaf) {
+		++leaf->pathingRevision;
+	}
+}
+
 bool Map::getPathMatching(const Creature& creature, std::forward_list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
 	Position pos = creature.getPosition();
@@ -736,21 +948,81 @@ bool Map::getPathMatching(const Creature& creature, std::forward_list<Direction>
 	return true;
 }
 
+bool Map::getRouteWaypoint(const Position& startPos, const Position& targetPos, Position& waypoint)
+{
+	if (startPos.z != targetPos.z || Position::areInRange<PATH_CLUSTER_SIZE, PATH_CLUSTER_SIZE>(startPos, targetPos)) {
+		return false;
+	}
+
+	std::vector<Position> waypoints;
+	if (!pathClusters.findRoute(*this, startPos, targetPos, waypoints)) {
+		return false;
+	}
+
+	// the first waypoint lies on the border of the start cluster, later ones may be in reach too
+	waypoint = waypoints.front();
+	for (const Position& pos : waypoints) {
+		if (!Position::areInRange<PATH_CLUSTER_SIZE, PATH_CLUSTER_SIZE>(startPos, pos)) {
+			break;
+		}
+		waypoint = pos;
+	}
+	return true;
+}
+
+const FlowField& Map::getFlowField(const Position& targetPos)
+{
+	// fields of positions the targets have left are only dropped in bulk
+	static constexpr size_t MAX_FLOW_FIELDS = 256;
+
+	const uint64_t key = (static_cast<uint64_t>(targetPos.x) << 24) | (static_cast<uint64_t>(targetPos.y) << 8) | targetPos.z;
+	if (flowFields.size() >= MAX_FLOW_FIELDS && flowFields.find(key) == flowFields.end()) {
+		flowFields.clear();
+	}
+
+	FlowField& field = flowFields[key];
+	if (!field.isBuilt()) {
+		field.build(*this, targetPos);
+	}
+	return field;
+}
+
 // AStarNodes
 
+namespace {
+
+uint16_t* getAStarGrid()
+{
+	// cleared again by ~AStarNodes, so only the cells a search touched are ever reset
+	static thread_local std::vector<uint16_t> grid(ASTAR_GRID_SIZE * ASTAR_GRID_SIZE);
+	return grid.data();
+}
+
+}
+
 AStarNodes::AStarNodes(uint32_t x, uint32_t y)
-	: nodes(), openNodes()
+	: nodeGrid(getAStarGrid()), startX(x), startY(y)
 {
 	curNode = 1;
 	closedNodes = 0;
-	openNodes[0] = true;
 
 	AStarNode& startNode = nodes[0];
 	startNode.parent = nullptr;
 	startNode.x = x;
 	startNode.y = y;
 	startNode.f = 0;
-	nodeTable[(x << 16) | y] = nodes;
+	nodeGrid[getGridCell(x, y)] = 1;
+	pushOpenNode(0);
+}
+
+AStarNodes::~AStarNodes()
+{
+	for (size_t i = 0; i < curNode; ++i) {
+		int32_t cell = getGridCell(nodes[i].x, nodes[i].y);
+		if (cell >= 0) {
+			nodeGrid[cell] = 0;
+		}
+	}
 }
 
 AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
@@ -760,43 +1032,46 @@ AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y,
 	}
 
 	size_t retNode = curNode++;
-	openNodes[retNode] = true;
 
 	AStarNode* node = nodes + retNode;
-	nodeTable[(x << 16) | y] = node;
+	int32_t cell = getGridCell(x, y);
+	if (cell >= 0) {
+		nodeGrid[cell] = retNode + 1;
+	} else {
+		nodeTable[(x << 16) | y] = node;
+	}
 	node->parent = parent;
 	node->x = x;
 	node->y = y;
 	node->f = f;
+	pushOpenNode(retNode);
 	return node;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
-	if (curNode == 0) {
+	if (heapSize == 0) {
 		return nullptr;
 	}
-
-	int32_t best_node_f = std::numeric_limits<int32_t>::max();
-	int32_t best_node = -1;
-	for (size_t i = 0; i < curNode; i++) {
-		if (openNodes[i] && nodes[i].f < best_node_f) {
-			best_node_f = nodes[i].f;
-			best_node = i;
-		}
-	}
-
-	if (best_node >= 0) {
-		return nodes + best_node;
-	}
-	return nullptr;
+	return nodes + openHeap[0];
 }
 
 void AStarNodes::closeNode(AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	openNodes[index] = false;
+
+	int16_t pos = heapPositions[index];
+	assert(pos >= 0);
+	heapPositions[index] = -1;
+
+	uint16_t last = openHeap[--heapSize];
+	if (static_cast<size_t>(pos) != heapSize) {
+		openHeap[pos] = last;
+		heapPositions[last] = pos;
+		siftDown(pos);
+		siftUp(heapPositions[last]);
+	}
 	++closedNodes;
 }
 
@@ -804,9 +1079,12 @@ void AStarNodes::openNode(AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	if (!openNodes[index]) {
-		openNodes[index] = true;
+	if (heapPositions[index] < 0) {
+		pushOpenNode(index);
 		--closedNodes;
+	} else {
+		// its f only ever decreases while open
+		siftUp(heapPositions[index]);
 	}
 }
 
@@ -817,6 +1095,15 @@ int_fast32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 {
+	int32_t cell = getGridCell(x, y);
+	if (cell >= 0) {
+		uint16_t index = nodeGrid[cell];
+		if (index == 0) {
+			return nullptr;
+		}
+		return nodes + (index - 1);
+	}
+
 	auto it = nodeTable.find((x << 16) | y);
 	if (it == nodeTable.end()) {
 		return nullptr;
@@ -824,6 +1111,66 @@ AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 	return it->second;
 }
 
+int32_t AStarNodes::getGridCell(uint32_t x, uint32_t y) const
+{
+	uint32_t gridX = x - startX + ASTAR_GRID_RADIUS;
+	uint32_t gridY = y - startY + ASTAR_GRID_RADIUS;
+	if (gridX >= static_cast<uint32_t>(ASTAR_GRID_SIZE) || gridY >= static_cast<uint32_t>(ASTAR_GRID_SIZE)) {
+		return -1;
+	}
+	return gridY * ASTAR_GRID_SIZE + gridX;
+}
+
+void AStarNodes::pushOpenNode(uint16_t index)
+{
+	size_t pos = heapSize++;
+	openHeap[pos] = index;
+	heapPositions[index] = pos;
+	siftUp(pos);
+}
+
+void AStarNodes::siftUp(size_t pos)
+{
+	uint16_t index = openHeap[pos];
+	while (pos > 0) {
+		size_t parent = (pos - 1) / 2;
+		if (!isBetterNode(index, openHeap[parent])) {
+			break;
+		}
+
+		openHeap[pos] = openHeap[parent];
+		heapPositions[openHeap[pos]] = pos;
+		pos = parent;
+	}
+	openHeap[pos] = index;
+	heapPositions[index] = pos;
+}
+
+void AStarNodes::siftDown(size_t pos)
+{
+	uint16_t index = openHeap[pos];
+	while (true) {
+		size_t child = pos * 2 + 1;
+		if (child >= heapSize) {
+			break;
+		}
+
+		if (child + 1 < heapSize && isBetterNode(openHeap[child + 1], openHeap[child])) {
+			++child;
+		}
+
+		if (!isBetterNode(openHeap[child], index)) {
+			break;
+		}
+
+		openHeap[pos] = openHeap[child];
+		heapPositions[openHeap[pos]] = pos;
+		pos = child;
+	}
+	openHeap[pos] = index;
+	heapPositions[index] = pos;
+}
+
 int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos)
 {
 	if (std::abs(node->x - neighborPos.x) == std::abs(node->y - neighborPos.y)) {
@@ -916,23 +1263,29 @@ Floor* QTreeLeafNode::createFloor(uint32_t z)
 	return array[z];
 }
 
-void QTreeLeafNode::addCreature(Creature* c)
+void QTreeLeafNode::addCreature(Creature* c, uint8_t z)
 {
-	creature_list.push_back(c);
+	Floor* floor = createFloor(z);
+	floor->creature_list.push_back(c);
 
 	if (c->getPlayer()) {
-		player_list.push_back(c);
+		floor->player_list.push_back(c);
 	}
 }
 
-void QTreeLeafNode::removeCreature(Creature* c)
+void QTreeLeafNode::removeCreature(Creature* c, uint8_t z)
 {
+	Floor* floor = array[z];
+	assert(floor);
+
+	CreatureVector& creature_list = floor->creature_list;
 	auto iter = std::find(creature_list.begin(), creature_list.end(), c);
 	assert(iter != creature_list.end());
 	*iter = creature_list.back();
 	creature_list.pop_back();
 
 	if (c->getPlayer()) {
+		CreatureVector& player_list = floor->player_list;
 		iter = std::find(player_list.begin(), player_list.end(), c);
 		assert(iter != player_list.end());
 		*iter = player_list.back();
@@ -940,7 +1293,31 @@ void QTreeLeafNode::removeCreature(Creature* c)
 	}
 }
 
-uint32_t Map::clean() const
+size_t Map::cleanTile(Tile* tile)
+{
+	if (tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
+		return 0;
+	}
+
+	TileItemVector* itemList = tile->getItemList();
+	if (!itemList) {
+		return 0;
+	}
+
+	std::vector<Item*> toRemove;
+	for (Item* item : *itemList) {
+		if (item->isCleanable()) {
+			toRemove.push_back(item);
+		}
+	}
+
+	for (Item* item : toRemove) {
+		g_game.internalRemoveItem(item, -1);
+	}
+	return toRemove.size();
+}
+
+uint32_t Map::clean()
 {
 	uint64_t start = OTSYS_TIME();
 	size_t count = 0, tiles = 0;
@@ -949,55 +1326,27 @@ uint32_t Map::clean() const
 		g_game.setGameState(GAME_STATE_MAINTAIN);
 	}
 
-	std::vector<const QTreeNode*> nodes {
-		&root
-	};
-	std::vector<Item*> toRemove;
-	do {
-		const QTreeNode* node = nodes.back();
-		nodes.pop_back();
-		if (node->isLeaf()) {
-			const QTreeLeafNode* leafNode = static_cast<const QTreeLeafNode*>(node);
-			for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
-				Floor* floor = leafNode->getFloor(z);
-				if (!floor) {
-					continue;
-				}
+	std::unordered_set<Tile*> toClean;
+	toClean.swap(cleanableTiles);
 
-				for (auto& row : floor->tiles) {
-					for (auto tile : row) {
-						if (!tile || tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
-							continue;
-						}
-
-						TileItemVector* itemList = tile->getItemList();
-						if (!itemList) {
-							continue;
-						}
-
-						++tiles;
-						for (Item* item : *itemList) {
-							if (item->isCleanable()) {
-								toRemove.push_back(item);
-							}
-						}
-
-						for (Item* item : toRemove) {
-							g_game.internalRemoveItem(item, -1);
-						}
-						count += toRemove.size();
-						toRemove.clear();
-					}
-				}
-			}
-		} else {
-			for (auto childNode : node->child) {
-				if (childNode) {
-					nodes.push_back(childNode);
-				}
-			}
-		}
-	} while (!nodes.empty());
+	// the tiles a running incremental sweep has not reached yet are no longer
+	// marked, they are cleaned here along with the rest
+	if (cleanQueueIndex < cleanQueue.size()) {
+		toClean.insert(cleanQueue.begin() + cleanQueueIndex, cleanQueue.end());
+
+		size_t sweptItems = cleanStats.items, sweptTiles = cleanStats.tiles;
+		std::cout << "> CLEAN: Incremental sweep interrupted after removing " << sweptItems << " item" << (sweptItems != 1 ? "s" : "")
+		          << " from " << sweptTiles << " tile" << (sweptTiles != 1 ? "s" : "") << " in "
+		          << cleanStats.elapsed / 1000. << " ms over " << cleanStats.slices << " slice" << (cleanStats.slices != 1 ? "s" : "")
+		          << ", cleaning the remaining " << cleanQueue.size() - cleanQueueIndex << " tiles now." << std::endl;
+	}
+	cleanQueue.clear();
+	cleanQueueIndex = 0;
+
+	for (Tile* tile : toClean) {
+		++tiles;
+		count += cleanTile(tile);
+	}
 
 	if (g_game.getGameState() == GAME_STATE_MAINTAIN) {
 		g_game.setGameState(GAME_STATE_NORMAL);
@@ -1008,3 +1357,66 @@ uint32_t Map::clean() const
 	          << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
 	return count;
 }
+
+bool Map::startIncrementalClean()
+{
+	if (cleanQueueIndex < cleanQueue.size()) {
+		return false;
+	}
+
+	cleanQueue.assign(cleanableTiles.begin(), cleanableTiles.end());
+	cleanQueueIndex = 0;
+	cleanableTiles.clear();
+
+	cleanStats = CleanStats();
+	cleanStats.startTime = OTSYS_TIME();
+	return !cleanQueue.empty();
+}
+
+bool Map::cleanSlice()
+{
+	static constexpr auto CLEAN_SLICE_BUDGET = std::chrono::milliseconds(2);
+	// checking the clock for every tile would cost more than most tiles do
+	static constexpr size_t CLEAN_CLOCK_STRIDE = 16;
+
+	if (cleanQueueIndex >= cleanQueue.size()) {
+		return false;
+	}
+
+	const auto sliceStart = std::chrono::steady_clock::now();
+	auto now = sliceStart;
+
+	size_t visited = 0;
+	while (cleanQueueIndex < cleanQueue.size()) {
+		cleanStats.items += cleanTile(cleanQueue[cleanQueueIndex++]);
+		++cleanStats.tiles;
+
+		if (++visited % CLEAN_CLOCK_STRIDE == 0) {
+			now = std::chrono::steady_clock::now();
+			if (now - sliceStart >= CLEAN_SLICE_BUDGET) {
+				break;
+			}
+		}
+	}
+
+	if (visited % CLEAN_CLOCK_STRIDE != 0) {
+		now = std::chrono::steady_clock::now();
+	}
+
+	cleanStats.elapsed += std::chrono::duration_cast<std::chrono::microseconds>(now - sliceStart).count();
+	++cleanStats.slices;
+
+	if (cleanQueueIndex < cleanQueue.size()) {
+		return true;
+	}
+
+	size_t count = cleanStats.items, tiles = cleanStats.tiles;
+	std::cout << "> CLEAN: Removed " << count << " item" << (count != 1 ? "s" : "")
+	          << " from " << tiles << " tile" << (tiles != 1 ? "s" : "") << " in "
+	          << cleanStats.elapsed / 1000. << " ms over " << cleanStats.slices << " slice" << (cleanStats.slices != 1 ? "s" : "")
+	          << " (" << (OTSYS_TIME() - cleanStats.startTime) / 1000. << " seconds total)." << std::endl;
+
+	cleanQueue.clear();
+	cleanQueueIndex = 0;
+	return false;
+}
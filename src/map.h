@@ -29,6 +29,8 @@
 #include "town.h"
 #include "house.h"
 #include "spawn.h"
+#include "pathclusters.h"
+#include "flowfield.h"
 
 class Creature;
 class Player;
@@ -46,6 +48,9 @@ struct AStarNode {
 };
 
 static constexpr int32_t MAX_NODES = 512;
+// nodes this close to the search start are indexed through a dense grid instead of a hash table
+static constexpr int32_t ASTAR_GRID_RADIUS = 64;
+static constexpr int32_t ASTAR_GRID_SIZE = ASTAR_GRID_RADIUS * 2;
 
 static constexpr int32_t MAP_NORMALWALKCOST = 10;
 static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
@@ -54,6 +59,11 @@ class AStarNodes
 {
 	public:
 		AStarNodes(uint32_t x, uint32_t y);
+		~AStarNodes();
+
+		// non-copyable
+		AStarNodes(const AStarNodes&) = delete;
+		AStarNodes& operator=(const AStarNodes&) = delete;
 
 		AStarNode* createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f);
 		AStarNode* getBestNode();
@@ -66,21 +76,106 @@ class AStarNodes
 		static int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
+		int32_t getGridCell(uint32_t x, uint32_t y) const;
+
+		// the heap is ordered by f, then by node index, so ties resolve to the oldest node
+		bool isBetterNode(uint16_t a, uint16_t b) const {
+			return nodes[a].f < nodes[b].f || (nodes[a].f == nodes[b].f && a < b);
+		}
+		void pushOpenNode(uint16_t index);
+		void siftUp(size_t pos);
+		void siftDown(size_t pos);
+
 		AStarNode nodes[MAX_NODES];
-		bool openNodes[MAX_NODES];
+		// open nodes as a binary min-heap, heapPositions holds each node's slot or -1 once closed
+		uint16_t openHeap[MAX_NODES];
+		int16_t heapPositions[MAX_NODES];
+		size_t heapSize = 0;
+
+		// node index + 1 by grid cell around the start, reused by every search of the thread
+		uint16_t* nodeGrid;
+		// nodes beyond the grid, only reached by long unbounded searches
 		std::unordered_map<uint32_t, AStarNode*> nodeTable;
+		uint32_t startX;
+		uint32_t startY;
+
 		size_t curNode;
 		int_fast32_t closedNodes;
 };
 
-using SpectatorCache = std::map<Position, SpectatorHashSet>;
+struct SpectatorCacheEntry {
+	SpectatorVec spectators;
+	SpectatorVec players;
+	bool hasSpectators = false;
+	bool hasPlayers = false;
+};
+
+// keyed by Map::getSpectatorCacheKey
+using SpectatorCache = std::unordered_map<uint64_t, SpectatorCacheEntry>;
+
+struct SpectatorCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t invalidated = 0;
+	uint64_t flushes = 0;
+};
+
+/**
+  * Area visited by Map::queryCreatures: a box of absolute
+  * coordinates on every floor from minZ to maxZ, optionally cut to a circle.
+  * A viewport area shifts the box by one tile per floor away from the center
+  * the way the client draws other floors, which is what getSpectators uses.
+  */
+struct SpatialArea {
+	static SpatialArea box(const Position& fromPos, const Position& toPos);
+	static SpatialArea square(const Position& centerPos, int32_t radius, uint8_t minZ, uint8_t maxZ);
+	static SpatialArea circle(const Position& centerPos, int32_t radius);
+	static SpatialArea circle(const Position& centerPos, int32_t radius, uint8_t minZ, uint8_t maxZ);
+	static SpatialArea viewport(const Position& centerPos, int32_t minRangeX, int32_t maxRangeX,
+	                            int32_t minRangeY, int32_t maxRangeY, int32_t minZ, int32_t maxZ);
+	// the viewport over every floor a client on centerPos gets to see
+	static SpatialArea visibleFrom(const Position& centerPos, int32_t minRangeX, int32_t maxRangeX,
+	                               int32_t minRangeY, int32_t maxRangeY);
+
+	bool contains(const Position& pos) const {
+		return contains(pos.x, pos.y, pos.z);
+	}
+	bool contains(int32_t x, int32_t y, int32_t z) const {
+		if (z < minZ || z > maxZ) {
+			return false;
+		}
+
+		int32_t offset = getFloorOffset(z);
+		if (x < minX + offset || x > maxX + offset || y < minY + offset || y > maxY + offset) {
+			return false;
+		}
+
+		return radius < 0 || isInRadius(x, y);
+	}
+	bool isInRadius(int32_t x, int32_t y) const {
+		int32_t dx = x - centerPos.x;
+		int32_t dy = y - centerPos.y;
+		return dx * dx + dy * dy <= radius * radius;
+	}
+
+	int32_t getFloorOffset(int32_t z) const {
+		return perspective ? centerPos.z - z : 0;
+	}
+
+	Position centerPos;
+	int32_t minX = 0, maxX = -1;
+	int32_t minY = 0, maxY = -1;
+	int32_t minZ = 0, maxZ = -1;
+	int32_t radius = -1;
+	bool perspective = false;
+};
 
 static constexpr int32_t FLOOR_BITS = 3;
 static constexpr int32_t FLOOR_SIZE = (1 << FLOOR_BITS);
 static constexpr int32_t FLOOR_MASK = (FLOOR_SIZE - 1);
 
 struct Floor {
-	constexpr Floor() = default;
+	Floor() = default;
 	~Floor();
 
 	// non-copyable
@@ -88,6 +183,27 @@ struct Floor {
 	Floor& operator=(const Floor&) = delete;
 
 	Tile* tiles[FLOOR_SIZE][FLOOR_SIZE] = {};
+
+	// creatures standing on these tiles, maintained by QTreeLeafNode
+	CreatureVector creature_list;
+	CreatureVector player_list;
+
+	// one bit per tile (see getTileBit), maintained by Map::updateTileBitmaps
+	// blockSolid: no tile, no ground or an immovable solid item, nothing can walk there
+	// blockPath: floor changes and teleports, never part of a path
+	uint64_t blockProjectile = 0;
+	uint64_t blockSolid = ~0ULL;
+	uint64_t blockPath = 0;
+
+	static uint64_t getTileBit(uint16_t x, uint16_t y) {
+		return 1ULL << ((x & FLOOR_MASK) | ((y & FLOOR_MASK) << FLOOR_BITS));
+	}
+	bool isProjectileBlocked(uint16_t x, uint16_t y) const {
+		return (blockProjectile & getTileBit(x, y)) != 0;
+	}
+	bool isPathBlocked(uint16_t x, uint16_t y) const {
+		return ((blockSolid | blockPath) & getTileBit(x, y)) != 0;
+	}
 };
 
 class FrozenPathingConditionCall;
@@ -149,21 +265,30 @@ class QTreeLeafNode final : public QTreeNode
 			return array[z];
 		}
 
-		void addCreature(Creature* c);
-		void removeCreature(Creature* c);
+		void addCreature(Creature* c, uint8_t z);
+		void removeCreature(Creature* c, uint8_t z);
 
 	protected:
 		static bool newLeaf;
 		QTreeLeafNode* leafS = nullptr;
 		QTreeLeafNode* leafE = nullptr;
 		Floor* array[MAP_MAX_LAYERS] = {};
-		CreatureVector creature_list;
-		CreatureVector player_list;
+		// bumped whenever something pathfinding reads changes in this leaf
+		uint32_t pathingRevision = 0;
 
 		friend class Map;
 		friend class QTreeNode;
 };
 
+// 32x32 tiles worth of leaves, the tile grid in front of the QTree is a dense table of these
+static constexpr int32_t TILE_CHUNK_BITS = 5;
+static constexpr int32_t TILE_CHUNK_LEAVES = (1 << (TILE_CHUNK_BITS - FLOOR_BITS));
+static constexpr int32_t TILE_CHUNK_LEAF_MASK = (TILE_CHUNK_LEAVES - 1);
+
+struct TileChunk {
+	QTreeLeafNode* leaves[TILE_CHUNK_LEAVES][TILE_CHUNK_LEAVES] = {};
+};
+
 /**
   * Map class.
   * Holds all the actual map-data
@@ -177,7 +302,31 @@ class Map
 		static constexpr int32_t maxClientViewportX = 8;
 		static constexpr int32_t maxClientViewportY = 6;
 
-		uint32_t clean() const;
+		/**
+		  * Removes the cleanable items from every tile marked by markCleanable.
+		  * \returns the number of removed items
+		  */
+		uint32_t clean();
+
+		/**
+		  * Remembers a tile that received a cleanable item so the cleaners
+		  * only have to visit those instead of the whole map.
+		  */
+		void markCleanable(Tile* tile) {
+			cleanableTiles.insert(tile);
+		}
+
+		/**
+		  * Queues the marked tiles for cleanSlice.
+		  * \returns false if a sweep is still in progress
+		  */
+		bool startIncrementalClean();
+
+		/**
+		  * Cleans queued tiles until the time budget is spent.
+		  * \returns true if tiles are left for another slice
+		  */
+		bool cleanSlice();
 
 		/**
 		  * Load a map.
@@ -219,12 +368,47 @@ class Map
 
 		void moveCreature(Creature& creature, Tile& newTile, bool forceTeleport = false);
 
-		void getSpectators(SpectatorHashSet& spectators, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
+		void getSpectators(SpectatorVec& spectators, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
 		                   int32_t minRangeX = 0, int32_t maxRangeX = 0,
 		                   int32_t minRangeY = 0, int32_t maxRangeY = 0);
 
+		/**
+		  * Calls callback for every creature inside area that passes filter,
+		  * straight from the QTree leaves without collecting them first. The
+		  * callback returns false to stop the query and must not move creatures.
+		  * \returns false if the callback stopped the query
+		  */
+		template<typename Callback>
+		bool queryCreatures(const SpatialArea& area, SpatialFilter_t filter, Callback&& callback) const;
+
 		void clearSpectatorCache();
 
+		/**
+		  * Drops the cached spectator lists whose area contains pos, has to be
+		  * called whenever a creature enters or leaves that position
+		  */
+		void invalidateSpectatorCache(const Position& pos);
+
+		SpectatorCacheStats takeSpectatorCacheStats() {
+			SpectatorCacheStats stats = spectatorCacheStats;
+			spectatorCacheStats = SpectatorCacheStats();
+			return stats;
+		}
+		void reportSpectatorCacheStats();
+		size_t getSpectatorCacheSize() const {
+			return spectatorCache.size();
+		}
+
+		/**
+		  * Revision of the state pathfinding reads (creatures and blocking items on
+		  * tiles, creature conditions and ghost mode) in the leaves overlapping the
+		  * given box, lets a path searched ahead of time be checked before it is used
+		  * \param fromPos The upper left corner of the box
+		  * \param toPos The lower right corner of the box
+		  */
+		uint32_t getPathingRevision(const Position& fromPos, const Position& toPos) const;
+		void invalidatePathing(const Position& pos);
+
 		/**
 		  * Checks if you can throw an object to that position
 		  *	\param fromPos from Source point
@@ -250,12 +434,46 @@ class Map
 
 		const Tile* canWalkTo(const Creature& creature, const Position& pos) const;
 
+		/**
+		  * Checks the per floor bitmaps, without touching the tile.
+		  * A blocked path means no creature can be placed there by path finding,
+		  * so callers may skip Tile::queryAdd.
+		  */
+		bool isProjectileBlocked(uint16_t x, uint16_t y, uint8_t z) const {
+			const Floor* floor = getFloor(x, y, z);
+			return floor && floor->isProjectileBlocked(x, y);
+		}
+		bool isPathBlocked(uint16_t x, uint16_t y, uint8_t z) const {
+			const Floor* floor = getFloor(x, y, z);
+			return !floor || floor->isPathBlocked(x, y);
+		}
+		bool isPathBlocked(const Position& pos) const {
+			return isPathBlocked(pos.x, pos.y, pos.z);
+		}
+		void updateTileBitmaps(const Tile& tile);
+
 		bool getPathMatching(const Creature& creature, std::forward_list<Direction>& dirList,
 		                     const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
 
+		/**
+		  * Looks up a route over the path clusters to a tile too far away for getPathMatching
+		  *	\param waypoint Receives the farthest point of the route a single getPathMatching can walk to
+		  *	\returns false if targetPos is near, on another floor or cannot be reached
+		  */
+		bool getRouteWaypoint(const Position& startPos, const Position& targetPos, Position& waypoint);
+
+		/**
+		  * The flow field towards targetPos shared by every creature chasing it,
+		  * built on first use and rebuilt once walkability inside its radius changes
+		  */
+		const FlowField& getFlowField(const Position& targetPos);
+
 		std::map<std::string, Position> waypoints;
 
 		QTreeLeafNode* getQTNode(uint16_t x, uint16_t y) {
+			if (isInTileGrid(x, y)) {
+				return getGridLeaf(x, y);
+			}
 			return QTreeNode::getLeafStatic<QTreeLeafNode*, QTreeNode*>(&root, x, y);
 		}
 
@@ -264,9 +482,18 @@ class Map
 		Houses houses;
 	protected:
 		SpectatorCache spectatorCache;
-		SpectatorCache playersSpectatorCache;
+		// centers of the cached entries, by 32x32 sector, to find the ones a move invalidates
+		std::unordered_map<uint32_t, std::vector<Position>> spectatorCacheSectors;
+		SpectatorCacheStats spectatorCacheStats;
 
 		QTreeNode root;
+		PathClusters pathClusters;
+		std::unordered_map<uint64_t, FlowField> flowFields;
+
+		// leaves of the map area declared in the OTBM header, looked up without descending the QTree
+		std::vector<std::unique_ptr<TileChunk>> tileChunks;
+		uint32_t tileChunksX = 0;
+		uint32_t tileChunksY = 0;
 
 		std::string spawnfile;
 		std::string housefile;
@@ -274,14 +501,122 @@ class Map
 		uint32_t width = 0;
 		uint32_t height = 0;
 
+		// tiles that received cleanable items since they were last cleaned
+		std::unordered_set<Tile*> cleanableTiles;
+		std::vector<Tile*> cleanQueue;
+		size_t cleanQueueIndex = 0;
+
+		struct CleanStats {
+			int64_t startTime = 0;
+			int64_t elapsed = 0; // microseconds spent in slices
+			size_t items = 0;
+			size_t tiles = 0;
+			size_t slices = 0;
+		};
+		CleanStats cleanStats;
+
+		size_t cleanTile(Tile* tile);
+
+		bool isInTileGrid(uint16_t x, uint16_t y) const {
+			return static_cast<uint32_t>(x >> TILE_CHUNK_BITS) < tileChunksX && static_cast<uint32_t>(y >> TILE_CHUNK_BITS) < tileChunksY;
+		}
+		QTreeLeafNode* getGridLeaf(uint16_t x, uint16_t y) const {
+			const TileChunk* chunk = tileChunks[(y >> TILE_CHUNK_BITS) * tileChunksX + (x >> TILE_CHUNK_BITS)].get();
+			if (!chunk) {
+				return nullptr;
+			}
+			return chunk->leaves[(y >> FLOOR_BITS) & TILE_CHUNK_LEAF_MASK][(x >> FLOOR_BITS) & TILE_CHUNK_LEAF_MASK];
+		}
+		const QTreeLeafNode* getLeaf(uint16_t x, uint16_t y) const {
+			if (isInTileGrid(x, y)) {
+				return getGridLeaf(x, y);
+			}
+			return QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+		}
+		void addGridLeaf(uint16_t x, uint16_t y, QTreeLeafNode* leaf);
+		Floor* getFloor(uint16_t x, uint16_t y, uint8_t z) const;
+
+		static uint64_t getSpectatorCacheKey(const Position& pos) {
+			return (static_cast<uint64_t>(pos.x) << 24) | (static_cast<uint64_t>(pos.y) << 8) | pos.z;
+		}
+		SpectatorCacheEntry& getSpectatorCacheEntry(const Position& centerPos);
+
 		// Actually scans the map for spectators
-		void getSpectatorsInternal(SpectatorHashSet& spectators, const Position& centerPos,
+		void getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos,
 		                           int32_t minRangeX, int32_t maxRangeX,
 		                           int32_t minRangeY, int32_t maxRangeY,
 		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
 
+		// calls callback with every floor of the leaves overlapping area, and the floor's base position
+		template<typename Callback>
+		bool forEachAreaFloor(const SpatialArea& area, Callback&& callback) const;
+
 		friend class Game;
 		friend class IOMap;
 };
 
+template<typename Callback>
+bool Map::forEachAreaFloor(const SpatialArea& area, Callback&& callback) const
+{
+	int32_t minZ = std::max<int32_t>(0, area.minZ);
+	int32_t maxZ = std::min<int32_t>(MAP_MAX_LAYERS - 1, area.maxZ);
+	if (minZ > maxZ || area.minX > area.maxX || area.minY > area.maxY) {
+		return true;
+	}
+
+	// the leaves have to cover the box of every floor, a viewport shifts it per floor
+	int32_t minoffset = area.getFloorOffset(maxZ);
+	int32_t maxoffset = area.getFloorOffset(minZ);
+	if (minoffset > maxoffset) {
+		std::swap(minoffset, maxoffset);
+	}
+
+	uint16_t x1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, area.minX + minoffset));
+	uint16_t y1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, area.minY + minoffset));
+	uint16_t x2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, area.maxX + maxoffset));
+	uint16_t y2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, area.maxY + maxoffset));
+
+	int32_t startx1 = x1 - (x1 % FLOOR_SIZE);
+	int32_t starty1 = y1 - (y1 % FLOOR_SIZE);
+	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
+	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
+
+	const QTreeLeafNode* startLeaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, starty1);
+	const QTreeLeafNode* leafS = startLeaf;
+	const QTreeLeafNode* leafE;
+
+	for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
+		leafE = leafS;
+		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
+			if (leafE) {
+				for (int32_t nz = minZ; nz <= maxZ; ++nz) {
+					const Floor* floor = leafE->getFloor(nz);
+					if (!floor) {
+						continue;
+					}
+
+					int32_t offset = area.getFloorOffset(nz);
+					if ((area.minY + offset) > (ny + FLOOR_MASK) || (area.maxY + offset) < ny || (area.minX + offset) > (nx + FLOOR_MASK) || (area.maxX + offset) < nx) {
+						continue;
+					}
+
+					if (!callback(*floor, nx, ny, nz)) {
+						return false;
+					}
+				}
+				leafE = leafE->leafE;
+			} else {
+				leafE = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, nx + FLOOR_SIZE, ny);
+			}
+		}
+
+		if (leafS) {
+			leafS = leafS->leafS;
+		} else {
+			leafS = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, ny + FLOOR_SIZE);
+		}
+	}
+	return true;
+}
+
 #endif
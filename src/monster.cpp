@@ -349,7 +349,7 @@ void Monster::updateTargetList()
 		}
 	}
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, true);
 	spectators.erase(this);
 	for (Creature* spectator : spectators) {
@@ -618,7 +618,7 @@ bool Monster::selectTarget(Creature* creature)
 
 	if (isHostile() || isSummon()) {
 		if (setAttackedCreature(creature) && !isSummon()) {
-			g_dispatcher.addTask(createTask(std::bind(&Game::checkCreatureAttack, &g_game, getID())));
+			g_dispatcher.addTask(createTask("Game::checkCreatureAttack", std::bind(&Game::checkCreatureAttack, &g_game, getID())));
 		}
 	}
 	return setFollowCreature(creature);
@@ -638,7 +638,7 @@ void Monster::setIdle(bool idle)
 		onIdleStatus();
 		clearTargetList();
 		clearFriendList();
-		Game::removeCreatureCheck(this);
+		g_game.removeCreatureCheck(this);
 	}
 }
 
@@ -655,10 +655,16 @@ void Monster::updateIdleStatus()
 	setIdle(idle);
 }
 
+bool Monster::canWalkOnField(CombatType_t combatType) const
+{
+	// immune, strong enough to take the damage or already suffering it anyway
+	return isImmune(combatType) || canPushItems() || hasCondition(Combat::DamageToConditionType(combatType));
+}
+
 void Monster::onAddCondition(ConditionType_t type)
 {
-	if (type == CONDITION_FIRE || type == CONDITION_ENERGY || type == CONDITION_POISON) {
-		updateMapCache();
+	if (type == CONDITION_FIRE || type == CONDITION_ENERGY || type == CONDITION_POISON || type == CONDITION_DROWN) {
+		updateWalkCacheFields();
 	}
 
 	updateIdleStatus();
@@ -666,8 +672,8 @@ void Monster::onAddCondition(ConditionType_t type)
 
 void Monster::onEndCondition(ConditionType_t type)
 {
-	if (type == CONDITION_FIRE || type == CONDITION_ENERGY || type == CONDITION_POISON) {
-		updateMapCache();
+	if (type == CONDITION_FIRE || type == CONDITION_ENERGY || type == CONDITION_POISON || type == CONDITION_DROWN) {
+		updateWalkCacheFields();
 	}
 
 	updateIdleStatus();
@@ -1097,6 +1103,12 @@ bool Monster::getNextStep(Direction& direction, uint32_t& flags)
 		}
 	} else if ((isSummon() && isMasterInRange) || followCreature) {
 		result = Creature::getNextStep(direction, flags);
+		if (!result && getFlowFieldStep(direction)) {
+			// the path ran out before reaching the target, keep descending its flow field
+			Creature::onWalk(direction);
+			result = true;
+		}
+
 		if (result) {
 			flags |= FLAG_PATHFINDING;
 		} else {
@@ -1146,6 +1158,50 @@ bool Monster::getRandomStep(const Position& creaturePos, Direction& direction) c
 	return false;
 }
 
+bool Monster::getFlowFieldStep(Direction& direction) const
+{
+	// the shared fields only serve melee chasers, everyone else keeps searching on its own
+	if (!followCreature || isSummon() || isFleeing() || mType->info.targetDistance > 1) {
+		return false;
+	}
+
+	const Position& creaturePos = getPosition();
+	const Position& targetPos = followCreature->getPosition();
+	if (creaturePos.z != targetPos.z || Position::areInRange<1, 1>(creaturePos, targetPos)) {
+		return false;
+	}
+
+	const FlowField& field = g_game.map.getFlowField(targetPos);
+	const int32_t cost = field.getCost(creaturePos);
+	if (cost < 0) {
+		return false;
+	}
+
+	int32_t bestCost = std::numeric_limits<int32_t>::max();
+	for (uint8_t i = 0; i <= DIRECTION_LAST; ++i) {
+		const Direction dir = static_cast<Direction>(i);
+		const Position pos = getNextPosition(dir, creaturePos);
+
+		int32_t nextCost = field.getCost(pos);
+		if (nextCost < 0 || nextCost >= cost) {
+			continue;
+		}
+
+		const Tile* tile = g_game.map.canWalkTo(*this, pos);
+		if (!tile) {
+			continue;
+		}
+
+		// weighed like getPathMatching does, so the chasers spread around each other
+		nextCost += ((dir & DIRECTION_DIAGONAL_MASK) ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST) + AStarNodes::getTileWalkCost(*this, tile);
+		if (nextCost < bestCost) {
+			bestCost = nextCost;
+			direction = dir;
+		}
+	}
+	return bestCost != std::numeric_limits<int32_t>::max();
+}
+
 bool Monster::getDanceStep(const Position& creaturePos, Direction& direction,
                            bool keepAttack /*= true*/, bool keepDistance /*= true*/)
 {
@@ -1947,7 +2003,7 @@ bool Monster::convinceCreature(Creature* creature)
 	updateIdleStatus();
 
 	//Notify surrounding about the change
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), true);
 	g_game.map.getSpectators(spectators, creature->getPosition(), true);
 	for (Creature* spectator : spectators) {
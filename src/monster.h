@@ -20,6 +20,8 @@
 #ifndef FS_MONSTER_H_9F5EEFE64314418CA7DA41D1B9409DD0
 #define FS_MONSTER_H_9F5EEFE64314418CA7DA41D1B9409DD0
 
+#include <unordered_set>
+
 #include "tile.h"
 #include "monsters.h"
 
@@ -107,6 +109,7 @@ class Monster final : public Creature
 		bool canPushItems() const {
 			return mType->info.canPushItems;
 		}
+		bool canWalkOnField(CombatType_t combatType) const final;
 		bool canPushCreatures() const {
 			return mType->info.canPushCreatures;
 		}
@@ -166,6 +169,7 @@ class Monster final : public Creature
 		}
 
 		bool getDistanceStep(const Position& targetPos, Direction& direction, bool flee = false);
+		bool getFlowFieldStep(Direction& direction) const;
 		bool isTargetNearby() const {
 			return stepDuration >= 1;
 		}
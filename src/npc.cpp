@@ -392,6 +392,13 @@ bool Npc::getNextStep(Direction& dir, uint32_t& flags)
 		return true;
 	}
 
+	if (hasMoveTarget) {
+		doMoveTo(moveTarget);
+		if (Creature::getNextStep(dir, flags)) {
+			return true;
+		}
+	}
+
 	if (walkTicks <= 0) {
 		return false;
 	}
@@ -486,9 +493,19 @@ bool Npc::getRandomStep(Direction& dir) const
 
 void Npc::doMoveTo(const Position& target)
 {
+	FindPathParams fpp;
+	fpp.minTargetDist = 1;
+	fpp.maxTargetDist = 1;
+
 	std::forward_list<Direction> listDir;
-	if (getPathTo(target, listDir, 1, 1, true, true)) {
+	bool routeLeg;
+	if (getPathTo(target, listDir, fpp, &routeLeg)) {
+		// getNextStep searches the next leg once this one is walked
+		hasMoveTarget = routeLeg && !listDir.empty();
+		moveTarget = target;
 		startAutoWalk(listDir);
+	} else {
+		hasMoveTarget = false;
 	}
 }
 
@@ -232,6 +232,9 @@ class Npc final : public Creature
 		NpcEventsHandler* npcEventHandler;
 
 		Position masterPos;
+		// the target of a doMoveTo that is walked one route leg at a time
+		Position moveTarget;
+		bool hasMoveTarget = false;
 
 		uint32_t walkTicks;
 		int32_t focusCreature;
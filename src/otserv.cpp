@@ -34,10 +34,13 @@
 #include "databasemanager.h"
 #include "scheduler.h"
 #include "databasetasks.h"
+#include "replay.h"
+#include "xtea.h"
 
 DatabaseTasks g_databaseTasks;
 Dispatcher g_dispatcher;
 Scheduler g_scheduler;
+Replay g_replay;
 
 Game g_game;
 ConfigManager g_config;
@@ -65,21 +68,58 @@ void badAllocationHandler()
 	exit(-1);
 }
 
+bool parseArguments(int argc, char* argv[])
+{
+	std::string recordFile, replayFile;
+	double replaySpeed = 0;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--record" && i + 1 < argc) {
+			recordFile = argv[++i];
+		} else if (arg == "--replay" && i + 1 < argc) {
+			replayFile = argv[++i];
+		} else if (arg == "--replay-speed" && i + 1 < argc) {
+			replaySpeed = std::max(0., atof(argv[++i]));
+		} else {
+			std::cout << "Usage: " << argv[0] << " [--record file | --replay file [--replay-speed factor]]" << std::endl;
+			return false;
+		}
+	}
+
+	if (!replayFile.empty()) {
+		if (!recordFile.empty()) {
+			std::cout << "> ERROR: --record and --replay cannot be used together." << std::endl;
+			return false;
+		}
+		return g_replay.load(replayFile, replaySpeed);
+	} else if (!recordFile.empty()) {
+		return g_replay.startRecording(recordFile);
+	}
+	return true;
+}
+
 int main(int argc, char* argv[])
 {
 	// Setup bad allocation handler
 	std::set_new_handler(badAllocationHandler);
 
+	if (!parseArguments(argc, argv)) {
+		return 1;
+	}
+
 	ServiceManager serviceManager;
 
 	g_dispatcher.start();
 	g_scheduler.start();
 
-	g_dispatcher.addTask(createTask(std::bind(mainLoader, argc, argv, &serviceManager)));
+	g_dispatcher.addTask(createTask("mainLoader", std::bind(mainLoader, argc, argv, &serviceManager)));
 
 	g_loaderSignal.wait(g_loaderUniqueLock);
 
-	if (serviceManager.is_running()) {
+	if (g_replay.isReplaying() && g_game.getGameState() == GAME_STATE_NORMAL) {
+		g_replay.run();
+		g_dispatcher.addTask(createTask("Game::setGameState", std::bind(&Game::setGameState, &g_game, GAME_STATE_SHUTDOWN)));
+	} else if (serviceManager.is_running()) {
 		std::cout << ">> " << g_config.getString(ConfigManager::SERVER_NAME) << " Server Online!" << std::endl << std::endl;
 		serviceManager.run();
 	} else {
@@ -92,6 +132,7 @@ int main(int argc, char* argv[])
 	g_scheduler.join();
 	g_databaseTasks.join();
 	g_dispatcher.join();
+	g_replay.stopRecording();
 	return 0;
 }
 
@@ -117,6 +158,7 @@ void mainLoader(int, char*[], ServiceManager* services)
 #else
 	std::cout << "unknown" << std::endl;
 #endif
+	std::cout << "Using " << xtea::getKernelName() << " XTEA kernels" << std::endl;
 	std::cout << std::endl;
 
 	std::cout << "A server developed by " << STATUS_SERVER_DEVELOPERS << std::endl;
@@ -232,15 +274,18 @@ void mainLoader(int, char*[], ServiceManager* services)
 	std::cout << ">> Initializing gamestate" << std::endl;
 	g_game.setGameState(GAME_STATE_INIT);
 
-	// Game client protocols
-	services->add<ProtocolGame>(g_config.getNumber(ConfigManager::GAME_PORT));
-	services->add<ProtocolLogin>(g_config.getNumber(ConfigManager::LOGIN_PORT));
+	// a replay runs headless, the recorded input is fed to the game directly
+	if (!g_replay.isReplaying()) {
+		// Game client protocols
+		services->add<ProtocolGame>(g_config.getNumber(ConfigManager::GAME_PORT));
+		services->add<ProtocolLogin>(g_config.getNumber(ConfigManager::LOGIN_PORT));
 
-	// OT protocols
-	services->add<ProtocolStatus>(g_config.getNumber(ConfigManager::STATUS_PORT));
+		// OT protocols
+		services->add<ProtocolStatus>(g_config.getNumber(ConfigManager::STATUS_PORT));
 
-	// Legacy login protocol
-	services->add<ProtocolOld>(g_config.getNumber(ConfigManager::LOGIN_PORT));
+		// Legacy login protocol
+		services->add<ProtocolOld>(g_config.getNumber(ConfigManager::LOGIN_PORT));
+	}
 
 	RentPeriod_t rentPeriod;
 	std::string strRentPeriod = asLowerCaseString(g_config.getString(ConfigManager::HOUSE_RENT_PERIOD));
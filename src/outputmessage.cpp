@@ -40,12 +40,14 @@ class OutputMessageAllocator
 void OutputMessagePool::scheduleSendAll()
 {
 	auto functor = std::bind(&OutputMessagePool::sendAll, this);
-	g_scheduler.addEvent(createSchedulerTask(OUTPUTMESSAGE_AUTOSEND_DELAY.count(), functor));
+	g_scheduler.addEvent(createSchedulerTask(OUTPUTMESSAGE_AUTOSEND_DELAY.count(), "OutputMessagePool::sendAll", functor));
 }
 
 void OutputMessagePool::sendAll()
 {
 	//dispatcher thread
+	DispatcherTickScope tickScope(TICK_CATEGORY_OUTPUT);
+
 	for (auto& protocol : bufferedProtocols) {
 		auto& msg = protocol->getCurrentBuffer();
 		if (msg) {
@@ -0,0 +1,340 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "pathclusters.h"
+#include "map.h"
+
+#include <queue>
+
+namespace {
+
+// a route search gives up after expanding this many portals
+constexpr size_t MAX_ROUTE_EXPANSIONS = 8192;
+// border openings this wide get a portal at each end instead of one in the middle
+constexpr int32_t WIDE_OPENING = 6;
+
+// cluster sides in the order of the PathCluster::Portal exit bits
+constexpr int32_t exitOffsets[4][2] = {
+	{0, -1}, {1, 0}, {0, 1}, {-1, 0}
+};
+
+constexpr int32_t neighborOffsets[8][2] = {
+	{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+};
+
+using ClusterDistances = int32_t[PATH_CLUSTER_SIZE * PATH_CLUSTER_SIZE];
+
+// walking costs from one tile to every tile of the cluster, without leaving it
+void getClusterDistances(const PathCluster& cluster, int32_t startX, int32_t startY, ClusterDistances& distances)
+{
+	std::fill(std::begin(distances), std::end(distances), -1);
+
+	using Entry = std::pair<int32_t, int32_t>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+	const int32_t startCell = (startY << PATH_CLUSTER_BITS) | startX;
+	distances[startCell] = 0;
+	open.emplace(0, startCell);
+
+	while (!open.empty()) {
+		const Entry entry = open.top();
+		open.pop();
+		if (entry.first > distances[entry.second]) {
+			continue;
+		}
+
+		const int32_t x = entry.second & PATH_CLUSTER_MASK;
+		const int32_t y = entry.second >> PATH_CLUSTER_BITS;
+		for (int32_t i = 0; i < 8; ++i) {
+			const int32_t nx = x + neighborOffsets[i][0];
+			const int32_t ny = y + neighborOffsets[i][1];
+			if (nx < 0 || ny < 0 || nx >= PATH_CLUSTER_SIZE || ny >= PATH_CLUSTER_SIZE || !cluster.isWalkable(nx, ny)) {
+				continue;
+			}
+
+			const int32_t cost = entry.first + (i >= 4 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+			int32_t& distance = distances[(ny << PATH_CLUSTER_BITS) | nx];
+			if (distance < 0 || cost < distance) {
+				distance = cost;
+				open.emplace(cost, (ny << PATH_CLUSTER_BITS) | nx);
+			}
+		}
+	}
+}
+
+void getBorderTile(int32_t side, int32_t i, int32_t& x, int32_t& y)
+{
+	switch (side) {
+		case 0: x = i; y = 0; break;
+		case 1: x = PATH_CLUSTER_MASK; y = i; break;
+		case 2: x = i; y = PATH_CLUSTER_MASK; break;
+		default: x = 0; y = i; break;
+	}
+}
+
+void addPortal(PathCluster& cluster, int32_t side, int32_t i)
+{
+	int32_t x, y;
+	getBorderTile(side, i, x, y);
+
+	uint8_t& index = cluster.portalIndex[y][x];
+	if (index == PathCluster::NO_PORTAL) {
+		index = cluster.portals.size();
+		cluster.portals.push_back({static_cast<uint8_t>(x), static_cast<uint8_t>(y), 0});
+	}
+	cluster.portals[index].exits |= 1 << side;
+}
+
+uint32_t getRouteKey(int32_t x, int32_t y)
+{
+	return (static_cast<uint32_t>(x) << 16) | static_cast<uint32_t>(y);
+}
+
+}
+
+const PathCluster& PathClusters::getCluster(const Map& map, uint16_t x, uint16_t y, uint8_t z)
+{
+	const uint64_t key = getClusterKey(x, y, z);
+	auto it = clusters.find(key);
+	if (it != clusters.end()) {
+		return it->second;
+	}
+
+	PathCluster& cluster = clusters[key];
+	build(map, cluster, x & ~PATH_CLUSTER_MASK, y & ~PATH_CLUSTER_MASK, z);
+	return cluster;
+}
+
+void PathClusters::build(const Map& map, PathCluster& cluster, uint16_t originX, uint16_t originY, uint8_t z)
+{
+	for (int32_t y = 0; y < PATH_CLUSTER_SIZE; ++y) {
+		uint16_t row = 0;
+		for (int32_t x = 0; x < PATH_CLUSTER_SIZE; ++x) {
+			if (!map.isPathBlocked(originX + x, originY + y, z)) {
+				row |= 1 << x;
+			}
+		}
+		cluster.walkable[y] = row;
+	}
+
+	memset(cluster.portalIndex, PathCluster::NO_PORTAL, sizeof(cluster.portalIndex));
+	cluster.portals.clear();
+
+	// openings are found the same way from both sides of a border, so the
+	// tile past a portal's exit is always a portal of the neighbor cluster
+	for (int32_t side = 0; side < 4; ++side) {
+		int32_t openingStart = -1;
+		for (int32_t i = 0; i <= PATH_CLUSTER_SIZE; ++i) {
+			bool open = false;
+			if (i < PATH_CLUSTER_SIZE) {
+				int32_t x, y;
+				getBorderTile(side, i, x, y);
+
+				const int32_t outerX = originX + x + exitOffsets[side][0];
+				const int32_t outerY = originY + y + exitOffsets[side][1];
+				open = cluster.isWalkable(x, y) && outerX >= 0 && outerY >= 0 && outerX <= 0xFFFF && outerY <= 0xFFFF &&
+				       !map.isPathBlocked(outerX, outerY, z);
+			}
+
+			if (open) {
+				if (openingStart < 0) {
+					openingStart = i;
+				}
+				continue;
+			}
+
+			if (openingStart < 0) {
+				continue;
+			}
+
+			const int32_t openingEnd = i - 1;
+			if (openingEnd - openingStart + 1 >= WIDE_OPENING) {
+				addPortal(cluster, side, openingStart);
+				addPortal(cluster, side, openingEnd);
+			} else {
+				addPortal(cluster, side, (openingStart + openingEnd) / 2);
+			}
+			openingStart = -1;
+		}
+	}
+
+	const size_t portalCount = cluster.portals.size();
+	cluster.costs.assign(portalCount * portalCount, -1);
+
+	ClusterDistances distances;
+	for (size_t i = 0; i < portalCount; ++i) {
+		getClusterDistances(cluster, cluster.portals[i].x, cluster.portals[i].y, distances);
+		for (size_t j = 0; j < portalCount; ++j) {
+			cluster.costs[i * portalCount + j] = distances[(cluster.portals[j].y << PATH_CLUSTER_BITS) | cluster.portals[j].x];
+		}
+	}
+}
+
+void PathClusters::invalidate(const Position& pos)
+{
+	if (clusters.empty()) {
+		return;
+	}
+
+	clusters.erase(getClusterKey(pos.x, pos.y, pos.z));
+
+	// the tile is also outside of the border of the neighbor clusters it touches
+	const int32_t x = pos.x & PATH_CLUSTER_MASK;
+	const int32_t y = pos.y & PATH_CLUSTER_MASK;
+	if (x == 0 && pos.x > 0) {
+		clusters.erase(getClusterKey(pos.x - 1, pos.y, pos.z));
+	} else if (x == PATH_CLUSTER_MASK && pos.x < 0xFFFF) {
+		clusters.erase(getClusterKey(pos.x + 1, pos.y, pos.z));
+	}
+
+	if (y == 0 && pos.y > 0) {
+		clusters.erase(getClusterKey(pos.x, pos.y - 1, pos.z));
+	} else if (y == PATH_CLUSTER_MASK && pos.y < 0xFFFF) {
+		clusters.erase(getClusterKey(pos.x, pos.y + 1, pos.z));
+	}
+}
+
+bool PathClusters::findRoute(const Map& map, const Position& startPos, const Position& targetPos, std::vector<Position>& waypoints)
+{
+	if (startPos.z != targetPos.z) {
+		return false;
+	}
+
+	const uint8_t z = startPos.z;
+
+	ClusterDistances startDistances;
+	const PathCluster& startCluster = getCluster(map, startPos.x, startPos.y, z);
+	getClusterDistances(startCluster, startPos.x & PATH_CLUSTER_MASK, startPos.y & PATH_CLUSTER_MASK, startDistances);
+	const uint16_t startOriginX = startPos.x & ~PATH_CLUSTER_MASK;
+	const uint16_t startOriginY = startPos.y & ~PATH_CLUSTER_MASK;
+
+	ClusterDistances targetDistances;
+	const PathCluster& targetCluster = getCluster(map, targetPos.x, targetPos.y, z);
+	getClusterDistances(targetCluster, targetPos.x & PATH_CLUSTER_MASK, targetPos.y & PATH_CLUSTER_MASK, targetDistances);
+	const uint64_t targetClusterKey = getClusterKey(targetPos.x, targetPos.y, z);
+
+	struct RouteNode {
+		int32_t cost;
+		uint32_t parent;
+		bool closed;
+	};
+
+	const uint32_t startKey = getRouteKey(startPos.x, startPos.y);
+	const uint32_t targetKey = getRouteKey(targetPos.x, targetPos.y);
+
+	std::unordered_map<uint32_t, RouteNode> nodes;
+	using Entry = std::pair<int32_t, uint32_t>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+	// every step costs at least MAP_NORMALWALKCOST, so this never overestimates
+	auto getEstimate = [&targetPos](uint32_t key) {
+		const int32_t dx = std::abs(static_cast<int32_t>(key >> 16) - targetPos.x);
+		const int32_t dy = std::abs(static_cast<int32_t>(key & 0xFFFF) - targetPos.y);
+		return std::max(dx, dy) * MAP_NORMALWALKCOST;
+	};
+
+	auto addNode = [&](uint32_t key, uint32_t parent, int32_t cost) {
+		auto it = nodes.find(key);
+		if (it == nodes.end()) {
+			nodes.emplace(key, RouteNode{cost, parent, false});
+		} else if (it->second.closed || it->second.cost <= cost) {
+			return;
+		} else {
+			it->second.cost = cost;
+			it->second.parent = parent;
+		}
+		open.emplace(cost + getEstimate(key), key);
+	};
+
+	addNode(startKey, startKey, 0);
+
+	size_t expansions = 0;
+	while (!open.empty()) {
+		const uint32_t key = open.top().second;
+		open.pop();
+
+		RouteNode& node = nodes[key];
+		if (node.closed) {
+			continue;
+		}
+		node.closed = true;
+
+		if (key == targetKey) {
+			waypoints.clear();
+			for (uint32_t current = key; current != startKey; current = nodes[current].parent) {
+				waypoints.emplace_back(current >> 16, current & 0xFFFF, z);
+			}
+			std::reverse(waypoints.begin(), waypoints.end());
+			return true;
+		}
+
+		if (++expansions > MAX_ROUTE_EXPANSIONS) {
+			return false;
+		}
+
+		const int32_t cost = node.cost;
+		const uint16_t x = key >> 16;
+		const uint16_t y = key & 0xFFFF;
+		const int32_t localX = x & PATH_CLUSTER_MASK;
+		const int32_t localY = y & PATH_CLUSTER_MASK;
+
+		if (key == startKey) {
+			for (const PathCluster::Portal& portal : startCluster.portals) {
+				int32_t distance = startDistances[(portal.y << PATH_CLUSTER_BITS) | portal.x];
+				if (distance > 0) {
+					addNode(getRouteKey(startOriginX + portal.x, startOriginY + portal.y), key, cost + distance);
+				}
+			}
+		}
+
+		if (getClusterKey(x, y, z) == targetClusterKey) {
+			int32_t distance = targetDistances[(localY << PATH_CLUSTER_BITS) | localX];
+			if (distance >= 0) {
+				addNode(targetKey, key, cost + distance);
+			}
+		}
+
+		const PathCluster& cluster = getCluster(map, x, y, z);
+		const uint8_t index = cluster.portalIndex[localY][localX];
+		if (index == PathCluster::NO_PORTAL) {
+			continue;
+		}
+
+		const uint16_t originX = x & ~PATH_CLUSTER_MASK;
+		const uint16_t originY = y & ~PATH_CLUSTER_MASK;
+		const size_t portalCount = cluster.portals.size();
+		for (size_t i = 0; i < portalCount; ++i) {
+			int32_t distance = cluster.costs[index * portalCount + i];
+			if (distance > 0) {
+				const PathCluster::Portal& portal = cluster.portals[i];
+				addNode(getRouteKey(originX + portal.x, originY + portal.y), key, cost + distance);
+			}
+		}
+
+		const uint8_t exits = cluster.portals[index].exits;
+		for (int32_t side = 0; side < 4; ++side) {
+			if (exits & (1 << side)) {
+				addNode(getRouteKey(x + exitOffsets[side][0], y + exitOffsets[side][1]), key, cost + MAP_NORMALWALKCOST);
+			}
+		}
+	}
+	return false;
+}
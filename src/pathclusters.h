@@ -0,0 +1,96 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_PATHCLUSTERS_H_F858F79C72B11F2C0AA25AF5D76080A3
+#define FS_PATHCLUSTERS_H_F858F79C72B11F2C0AA25AF5D76080A3
+
+#include "position.h"
+
+class Map;
+
+static constexpr int32_t PATH_CLUSTER_BITS = 4;
+static constexpr int32_t PATH_CLUSTER_SIZE = (1 << PATH_CLUSTER_BITS);
+static constexpr int32_t PATH_CLUSTER_MASK = (PATH_CLUSTER_SIZE - 1);
+
+// A square of one floor, with entrances (portals) where its border can be walked
+// across and the walking costs between them inside the square
+struct PathCluster {
+	struct Portal {
+		uint8_t x, y;
+		// one bit per side the portal crosses: north, east, south, west
+		uint8_t exits;
+	};
+
+	std::vector<Portal> portals;
+	// portals.size() squared, -1 where one portal cannot reach the other inside the cluster
+	std::vector<int32_t> costs;
+	// portal index by tile, NO_PORTAL where there is none
+	uint8_t portalIndex[PATH_CLUSTER_SIZE][PATH_CLUSTER_SIZE];
+	// one bit per tile and row, set where Map::isPathBlocked is false
+	uint16_t walkable[PATH_CLUSTER_SIZE];
+
+	static constexpr uint8_t NO_PORTAL = 0xFF;
+
+	bool isWalkable(int32_t x, int32_t y) const {
+		return (walkable[y] & (1 << x)) != 0;
+	}
+};
+
+/**
+  * Abstraction layer over the map for long routes, in the manner of HPA*.
+  * Clusters are built from the walkability bitmaps when a route first needs
+  * them and dropped again when a tile of theirs changes walkability.
+  * Only static walkability is considered, creatures, fields and movable
+  * items are left to the A* search that walks each leg of the route.
+  */
+class PathClusters
+{
+	public:
+		PathClusters() = default;
+
+		// non-copyable
+		PathClusters(const PathClusters&) = delete;
+		PathClusters& operator=(const PathClusters&) = delete;
+
+		/**
+		  * Searches a route between two tiles of the same floor across cluster portals
+		  * \param waypoints Receives the portals to pass, in order, followed by targetPos
+		  * \returns false if the tiles are on different floors, no route exists or the search gave up
+		  */
+		bool findRoute(const Map& map, const Position& startPos, const Position& targetPos, std::vector<Position>& waypoints);
+
+		// drops the clusters whose portals or costs depend on the tile at pos
+		void invalidate(const Position& pos);
+
+		size_t getClusterCount() const {
+			return clusters.size();
+		}
+
+	private:
+		const PathCluster& getCluster(const Map& map, uint16_t x, uint16_t y, uint8_t z);
+		static void build(const Map& map, PathCluster& cluster, uint16_t originX, uint16_t originY, uint8_t z);
+
+		static uint64_t getClusterKey(uint16_t x, uint16_t y, uint8_t z) {
+			return (static_cast<uint64_t>(x >> PATH_CLUSTER_BITS) << 24) | (static_cast<uint64_t>(y >> PATH_CLUSTER_BITS) << 8) | z;
+		}
+
+		std::unordered_map<uint64_t, PathCluster> clusters;
+};
+
+#endif
@@ -696,6 +696,13 @@ bool Player::canSeeCreature(const Creature* creature) const
 	return true;
 }
 
+void Player::switchGhostMode()
+{
+	ghostMode = !ghostMode;
+	// creatures in ghost mode do not block the paths of others
+	g_game.map.invalidatePathing(getPosition());
+}
+
 bool Player::canWalkthrough(const Creature* creature) const
 {
 	if (group->access || creature->isInGhostMode()) {
@@ -1222,7 +1229,7 @@ void Player::onCreatureMove(Creature* creature, const Tile* newTile, const Posit
 
 	if (hasFollowPath && (creature == followCreature || (creature == this && followCreature))) {
 		isUpdatingPath = false;
-		g_dispatcher.addTask(createTask(std::bind(&Game::updateCreatureWalk, &g_game, getID())));
+		g_dispatcher.addTask(createTask("Game::updateCreatureWalk", std::bind(&Game::updateCreatureWalk, &g_game, getID())));
 	}
 
 	if (creature != this) {
@@ -1598,7 +1605,7 @@ void Player::addExperience(Creature* source, uint64_t exp, bool sendText/* = fal
 		message.primary.color = TEXTCOLOR_WHITE_EXP;
 		sendTextMessage(message);
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, position, false, true);
 		spectators.erase(this);
 		if (!spectators.empty()) {
@@ -1681,7 +1688,7 @@ void Player::removeExperience(uint64_t exp, bool sendText/* = false*/)
 		message.primary.color = TEXTCOLOR_RED;
 		sendTextMessage(message);
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, position, false, true);
 		spectators.erase(this);
 		if (!spectators.empty()) {
@@ -3111,7 +3118,7 @@ bool Player::setAttackedCreature(Creature* creature)
 	}
 
 	if (creature) {
-		g_dispatcher.addTask(createTask(std::bind(&Game::checkCreatureAttack, &g_game, getID())));
+		g_dispatcher.addTask(createTask("Game::checkCreatureAttack", std::bind(&Game::checkCreatureAttack, &g_game, getID())));
 	}
 	return true;
 }
@@ -3157,7 +3164,7 @@ void Player::doAttacking(uint32_t)
 				result = weapon->useWeapon(this, tool, attackedCreature);
 			} else if (!canDoAction()) {
 				uint32_t delay = getNextActionTime();
-				SchedulerTask* task = createSchedulerTask(delay, std::bind(&Game::checkCreatureAttack,
+				SchedulerTask* task = createSchedulerTask(delay, "Game::checkCreatureAttack", std::bind(&Game::checkCreatureAttack,
 				                      &g_game, getID()));
 				setNextActionTask(task);
 			} else {
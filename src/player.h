@@ -371,9 +371,7 @@ class Player final : public Creature, public Cylinder
 		bool isInGhostMode() const {
 			return ghostMode;
 		}
-		void switchGhostMode() {
-			ghostMode = !ghostMode;
-		}
+		void switchGhostMode();
 
 		uint32_t getAccount() const {
 			return accountNumber;
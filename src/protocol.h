@@ -21,6 +21,7 @@
 #define FS_PROTOCOL_H_D71405071ACF4137A4B1203899DE80E1
 
 #include "connection.h"
+#include "xtea.h"
 
 class Protocol : public std::enable_shared_from_this<Protocol>
 {
@@ -72,7 +73,9 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 			encryptionEnabled = true;
 		}
 		void setXTEAKey(const uint32_t* key) {
-			memcpy(this->key, key, sizeof(*key) * 4);
+			xtea::key k;
+			memcpy(k.data(), key, sizeof(*key) * 4);
+			this->key = xtea::expandKey(k);
 		}
 		void disableChecksum() {
 			checksumEnabled = false;
@@ -92,7 +95,7 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 		OutputMessage_ptr outputBuffer;
 	private:
 		const ConnectionWeak_ptr connection;
-		uint32_t key[4] = {};
+		xtea::round_keys key = {};
 		bool encryptionEnabled = false;
 		bool checksumEnabled = true;
 		bool rawMessages = false;
@@ -35,15 +35,39 @@
 #include "waitlist.h"
 #include "ban.h"
 #include "scheduler.h"
+#include "replay.h"
 
 extern ConfigManager g_config;
 extern Actions actions;
 extern CreatureEvents* g_creatureEvents;
 extern Chat* g_chat;
 
+namespace {
+
+const char* getPacketTag(uint8_t recvbyte)
+{
+	static const auto tags = []() {
+		std::array<std::string, 256> tags;
+		for (size_t i = 0; i < tags.size(); ++i) {
+			std::ostringstream ss;
+			ss << "ProtocolGame packet 0x" << std::hex << std::setw(2) << std::setfill('0') << i;
+			tags[i] = ss.str();
+		}
+		return tags;
+	}();
+	return tags[recvbyte].c_str();
+}
+
+}
+
 void ProtocolGame::release()
 {
 	//dispatcher thread
+	uint32_t sessionId = replaySessionId.exchange(0);
+	if (sessionId != 0) {
+		g_replay.recordLogout(sessionId);
+	}
+
 	if (player && player->client == shared_from_this()) {
 		player->client.reset();
 		player->decrementReferenceCounter();
@@ -57,6 +81,10 @@ void ProtocolGame::release()
 void ProtocolGame::login(const std::string& name, uint32_t accountId, OperatingSystem_t operatingSystem)
 {
 	//dispatcher thread
+	if (g_replay.isRecording()) {
+		replaySessionId = g_replay.recordLogin(name, accountId, operatingSystem);
+	}
+
 	Player* foundPlayer = g_game.getPlayerByName(name);
 	if (!foundPlayer || g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
 		player = new Player(getThis());
@@ -158,7 +186,7 @@ void ProtocolGame::login(const std::string& name, uint32_t accountId, OperatingS
 			foundPlayer->disconnect();
 			foundPlayer->isConnecting = true;
 
-			eventConnect = g_scheduler.addEvent(createSchedulerTask(1000, std::bind(&ProtocolGame::connect, getThis(), foundPlayer->getID(), operatingSystem)));
+			eventConnect = g_scheduler.addEvent(createSchedulerTask(1000, "ProtocolGame::connect", std::bind(&ProtocolGame::connect, getThis(), foundPlayer->getID(), operatingSystem)));
 		} else {
 			connect(foundPlayer->getID(), operatingSystem);
 		}
@@ -332,7 +360,9 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage& msg)
 		return;
 	}
 
-	g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::login, getThis(), characterName, accountId, operatingSystem)));
+	Task* task = createTask("ProtocolGame::login", std::bind(&ProtocolGame::login, getThis(), characterName, accountId, operatingSystem));
+	task->setTickCategory(TICK_CATEGORY_NETWORK);
+	g_dispatcher.addTask(task);
 }
 
 void ProtocolGame::onConnect()
@@ -384,6 +414,12 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		return;
 	}
 
+	// a packet racing the logout may still carry the old session, the replay drops those
+	uint32_t sessionId = replaySessionId.load();
+	if (sessionId != 0) {
+		g_replay.recordPacket(sessionId, msg);
+	}
+
 	uint8_t recvbyte = msg.getByte();
 
 	if (!player) {
@@ -406,8 +442,10 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		}
 	}
 
+	packetTag = getPacketTag(recvbyte);
+
 	switch (recvbyte) {
-		case 0x14: g_dispatcher.addTask(createTask(std::bind(&ProtocolGame::logout, getThis(), true, false))); break;
+		case 0x14: g_dispatcher.addTask(createTask("ProtocolGame::logout", std::bind(&ProtocolGame::logout, getThis(), true, false))); break;
 		case 0x1D: addGameTask(&Game::playerReceivePingBack, player->getID()); break;
 		case 0x1E: addGameTask(&Game::playerReceivePing, player->getID()); break;
 		case 0x32: parseExtendedOpcode(msg); break; //otclient extended opcode
@@ -20,6 +20,8 @@
 #ifndef FS_PROTOCOLGAME_H_FACA2A2D1A9348B78E8FD7E8003EBB87
 #define FS_PROTOCOLGAME_H_FACA2A2D1A9348B78E8FD7E8003EBB87
 
+#include <atomic>
+
 #include "protocol.h"
 #include "chat.h"
 #include "creature.h"
@@ -300,23 +302,33 @@ class ProtocolGame final : public Protocol
 		void parseExtendedOpcode(NetworkMessage& msg);
 
 		friend class Player;
+		friend class Replay;
 
 		// Helpers so we don't need to bind every time
 		template <typename Callable, typename... Args>
 		void addGameTask(Callable function, Args&&... args) {
-			g_dispatcher.addTask(createTask(std::bind(function, &g_game, std::forward<Args>(args)...)));
+			Task* task = createTask(packetTag, std::bind(function, &g_game, std::forward<Args>(args)...));
+			task->setTickCategory(TICK_CATEGORY_NETWORK);
+			g_dispatcher.addTask(task);
 		}
 
 		template <typename Callable, typename... Args>
 		void addGameTaskTimed(uint32_t delay, Callable function, Args&&... args) {
-			g_dispatcher.addTask(createTask(delay, std::bind(function, &g_game, std::forward<Args>(args)...)));
+			Task* task = createTask(delay, packetTag, std::bind(function, &g_game, std::forward<Args>(args)...));
+			task->setTickCategory(TICK_CATEGORY_NETWORK);
+			g_dispatcher.addTask(task);
 		}
 
 		std::unordered_set<uint32_t> knownCreatureSet;
 		Player* player = nullptr;
 
+		// task profiler tag of the packet being parsed
+		const char* packetTag = nullptr;
+
 		uint32_t eventConnect = 0;
 		uint32_t challengeTimestamp = 0;
+		// set and cleared on the dispatcher, read by the network thread for every packet
+		std::atomic<uint32_t> replaySessionId {0};
 		uint16_t version = CLIENT_VERSION_MIN;
 
 		uint8_t challengeRandom = 0;
@@ -61,7 +61,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 		//XML info protocol
 		case 0xFF: {
 			if (msg.getString(4) == "info") {
-				g_dispatcher.addTask(createTask(std::bind(&ProtocolStatus::sendStatusString,
+				g_dispatcher.addTask(createTask("ProtocolStatus::sendStatusString", std::bind(&ProtocolStatus::sendStatusString,
 									  std::static_pointer_cast<ProtocolStatus>(shared_from_this()))));
 				return;
 			}
@@ -75,7 +75,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 			if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
 				characterName = msg.getString();
 			}
-			g_dispatcher.addTask(createTask(std::bind(&ProtocolStatus::sendInfo, std::static_pointer_cast<ProtocolStatus>(shared_from_this()),
+			g_dispatcher.addTask(createTask("ProtocolStatus::sendInfo", std::bind(&ProtocolStatus::sendInfo, std::static_pointer_cast<ProtocolStatus>(shared_from_this()),
 								  requestedInfo, characterName)));
 			return;
 		}
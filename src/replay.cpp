@@ -0,0 +1,358 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <fstream>
+#include <future>
+
+#include "replay.h"
+#include "fileloader.h"
+#include "game.h"
+#include "protocolgame.h"
+#include "scheduler.h"
+#include "tools.h"
+
+extern Game g_game;
+
+static constexpr char REPLAY_FILE_IDENTIFIER[] = {'T', 'F', 'S', 'R'};
+static constexpr uint16_t REPLAY_FILE_VERSION = 1;
+
+uint32_t Replay::getTime() const
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool Replay::startRecording(const std::string& fileName)
+{
+	file = fopen(fileName.c_str(), "wb");
+	if (!file) {
+		std::cout << "[Error - Replay::startRecording] Cannot open " << fileName << " for writing." << std::endl;
+		return false;
+	}
+
+	std::random_device rd;
+	uint32_t seed = rd();
+	getRandomGenerator().seed(seed);
+
+	PropWriteStream header;
+	for (char c : REPLAY_FILE_IDENTIFIER) {
+		header.write<char>(c);
+	}
+	header.write<uint16_t>(REPLAY_FILE_VERSION);
+	header.write<uint32_t>(seed);
+
+	size_t size;
+	const char* data = header.getStream(size);
+	fwrite(data, 1, size, file);
+
+	startTime = std::chrono::steady_clock::now();
+	recording = true;
+	std::cout << "> Recording game input to " << fileName << '.' << std::endl;
+	return true;
+}
+
+bool Replay::load(const std::string& fileName, double speed)
+{
+	std::ifstream is(fileName, std::ios::binary);
+	if (!is) {
+		std::cout << "[Error - Replay::load] Cannot open " << fileName << '.' << std::endl;
+		return false;
+	}
+
+	std::string buffer((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+
+	PropStream propStream;
+	propStream.init(buffer.data(), buffer.size());
+
+	char identifier[sizeof(REPLAY_FILE_IDENTIFIER)];
+	for (char& c : identifier) {
+		if (!propStream.read<char>(c)) {
+			break;
+		}
+	}
+
+	uint16_t version;
+	uint32_t seed;
+	if (memcmp(identifier, REPLAY_FILE_IDENTIFIER, sizeof(identifier)) != 0 || !propStream.read<uint16_t>(version) || !propStream.read<uint32_t>(seed)) {
+		std::cout << "[Error - Replay::load] " << fileName << " is not a recording." << std::endl;
+		return false;
+	}
+
+	if (version != REPLAY_FILE_VERSION) {
+		std::cout << "[Error - Replay::load] " << fileName << " has unsupported version " << version << '.' << std::endl;
+		return false;
+	}
+
+	while (propStream.size() != 0) {
+		ReplayRecord record;
+		uint8_t type;
+		if (!propStream.read<uint32_t>(record.time) || !propStream.read<uint8_t>(type) || !propStream.read<uint32_t>(record.sessionId)) {
+			std::cout << "[Warning - Replay::load] " << fileName << " is truncated, replaying the first " << records.size() << " records." << std::endl;
+			break;
+		}
+
+		record.type = static_cast<ReplayRecordType>(type);
+		record.accountId = 0;
+		record.operatingSystem = CLIENTOS_NONE;
+
+		bool valid;
+		switch (record.type) {
+			case REPLAY_RECORD_LOGIN: {
+				uint8_t operatingSystem;
+				valid = propStream.readString(record.data) && propStream.read<uint32_t>(record.accountId) && propStream.read<uint8_t>(operatingSystem);
+				record.operatingSystem = static_cast<OperatingSystem_t>(operatingSystem);
+				break;
+			}
+
+			case REPLAY_RECORD_PACKET:
+				valid = propStream.readString(record.data);
+				break;
+
+			case REPLAY_RECORD_LOGOUT:
+				valid = true;
+				break;
+
+			case REPLAY_RECORD_SCHEDULER: {
+				uint32_t count;
+				valid = propStream.read<uint32_t>(count);
+				recordedSchedulerEvents += count;
+				break;
+			}
+
+			default:
+				valid = false;
+				break;
+		}
+
+		if (!valid) {
+			std::cout << "[Warning - Replay::load] " << fileName << " is corrupt, replaying the first " << records.size() << " records." << std::endl;
+			break;
+		}
+
+		if (record.type != REPLAY_RECORD_SCHEDULER) {
+			records.push_back(std::move(record));
+		}
+	}
+
+	getRandomGenerator().seed(seed);
+	g_scheduler.useVirtualClock();
+
+	this->speed = speed;
+	replaying = true;
+	std::cout << "> Loaded " << records.size() << " records to replay from " << fileName << '.' << std::endl;
+	return true;
+}
+
+void Replay::write(const PropWriteStream& record)
+{
+	size_t size;
+	const char* data = record.getStream(size);
+
+	std::lock_guard<std::mutex> lockGuard(recordLock);
+	fwrite(data, 1, size, file);
+}
+
+uint32_t Replay::recordLogin(const std::string& name, uint32_t accountId, OperatingSystem_t operatingSystem)
+{
+	uint32_t sessionId;
+	{
+		std::lock_guard<std::mutex> lockGuard(recordLock);
+		sessionId = ++lastSessionId;
+	}
+
+	PropWriteStream record;
+	record.write<uint32_t>(getTime());
+	record.write<uint8_t>(REPLAY_RECORD_LOGIN);
+	record.write<uint32_t>(sessionId);
+	record.writeString(name);
+	record.write<uint32_t>(accountId);
+	record.write<uint8_t>(operatingSystem);
+	write(record);
+	return sessionId;
+}
+
+void Replay::recordPacket(uint32_t sessionId, const NetworkMessage& msg)
+{
+	// the decoded body the protocol is about to parse
+	const size_t size = msg.getLength() + NetworkMessage::INITIAL_BUFFER_POSITION - msg.getBufferPosition();
+
+	PropWriteStream record;
+	record.write<uint32_t>(getTime());
+	record.write<uint8_t>(REPLAY_RECORD_PACKET);
+	record.write<uint32_t>(sessionId);
+	record.writeString(std::string(reinterpret_cast<const char*>(msg.getBuffer() + msg.getBufferPosition()), size));
+	write(record);
+}
+
+void Replay::recordLogout(uint32_t sessionId)
+{
+	PropWriteStream record;
+	record.write<uint32_t>(getTime());
+	record.write<uint8_t>(REPLAY_RECORD_LOGOUT);
+	record.write<uint32_t>(sessionId);
+	write(record);
+}
+
+void Replay::onSchedulerEvents(size_t count)
+{
+	if (replaying) {
+		replayedSchedulerEvents += count;
+	} else if (recording) {
+		PropWriteStream record;
+		record.write<uint32_t>(getTime());
+		record.write<uint8_t>(REPLAY_RECORD_SCHEDULER);
+		record.write<uint32_t>(0);
+		record.write<uint32_t>(count);
+		write(record);
+	}
+}
+
+void Replay::stopRecording()
+{
+	std::lock_guard<std::mutex> lockGuard(recordLock);
+	if (file) {
+		fclose(file);
+		file = nullptr;
+	}
+	recording = false;
+}
+
+void Replay::apply(const ReplayRecord& record)
+{
+	switch (record.type) {
+		case REPLAY_RECORD_LOGIN: {
+			ProtocolGame_ptr protocol = std::make_shared<ProtocolGame>(Connection_ptr());
+			sessions[record.sessionId] = protocol;
+
+			Task* task = createTask("ProtocolGame::login", std::bind(&ProtocolGame::login, protocol, record.data, record.accountId, record.operatingSystem));
+			task->setTickCategory(TICK_CATEGORY_NETWORK);
+			g_dispatcher.addTask(task);
+
+			// packets are only accepted once the player is in game
+			waitForDispatcher();
+			break;
+		}
+
+		case REPLAY_RECORD_PACKET: {
+			auto it = sessions.find(record.sessionId);
+			if (it == sessions.end()) {
+				break;
+			}
+
+			msg.reset();
+			memcpy(msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION, record.data.data(), record.data.size());
+			msg.setLength(record.data.size());
+			it->second->parsePacket(msg);
+			break;
+		}
+
+		case REPLAY_RECORD_LOGOUT: {
+			auto it = sessions.find(record.sessionId);
+			if (it == sessions.end()) {
+				break;
+			}
+
+			g_dispatcher.addTask(createTask("Protocol::release", std::bind(&ProtocolGame::release, it->second)));
+			sessions.erase(it);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void Replay::advanceClock(uint32_t time)
+{
+	// the events fired on the way schedule events of their own, which may be
+	// due before time as well
+	uint64_t eventTime;
+	while ((eventTime = g_scheduler.getNextEventTime()) <= time) {
+		setVirtualTime(virtualTimeBase + eventTime);
+		g_scheduler.advanceClock(eventTime);
+		waitForDispatcher();
+	}
+
+	setVirtualTime(virtualTimeBase + time);
+	g_scheduler.advanceClock(time);
+}
+
+void Replay::waitForDispatcher() const
+{
+	auto promise = std::make_shared<std::promise<void>>();
+	std::future<void> future = promise->get_future();
+	g_dispatcher.addTask(createTask("Replay::waitForDispatcher", [promise]() {
+		promise->set_value();
+	}));
+	future.wait();
+}
+
+void Replay::run()
+{
+	std::cout << ">> Replaying " << records.size() << " records " << (speed > 0 ? "at recorded pace" : "as fast as possible");
+	if (speed > 0 && speed != 1) {
+		std::cout << " x" << speed;
+	}
+	std::cout << std::endl;
+
+	waitForDispatcher();
+
+	// the virtual clock starts where loading left the wall clock
+	virtualTimeBase = OTSYS_TIME();
+	setVirtualTime(virtualTimeBase);
+
+	const uint64_t startCycle = g_dispatcher.getDispatcherCycle();
+	startTime = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < records.size();) {
+		const uint32_t time = records[i].time;
+		if (speed > 0) {
+			std::this_thread::sleep_until(startTime + std::chrono::microseconds(static_cast<int64_t>(time * 1000 / speed)));
+		}
+
+		// the timers due by then fire first, then everything recorded in the same
+		// millisecond goes in together and the dispatcher has to catch up before
+		// time moves on
+		advanceClock(time);
+		for (; i < records.size() && records[i].time == time; ++i) {
+			apply(records[i]);
+		}
+		waitForDispatcher();
+	}
+
+	const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	const uint64_t tasks = g_dispatcher.getDispatcherCycle() - startCycle;
+	const uint32_t recordedTime = records.empty() ? 0 : records.back().time;
+
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << ">> Replay done: " << tasks << " tasks in " << elapsed / 1000. << " ms (" << (elapsed > 0 ? tasks * 1000000. / elapsed : 0) << " tasks/s)";
+	if (recordedTime != 0) {
+		ss << ", " << elapsed * 60. / recordedTime << " ms per simulated minute";
+	}
+	ss << "; scheduler events recorded " << recordedSchedulerEvents << ", replayed " << replayedSchedulerEvents.load() << '.';
+	std::cout << ss.str() << std::endl;
+
+	for (const auto& it : sessions) {
+		g_dispatcher.addTask(createTask("Protocol::release", std::bind(&ProtocolGame::release, it.second)));
+	}
+	sessions.clear();
+	waitForDispatcher();
+}
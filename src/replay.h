@@ -0,0 +1,113 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_REPLAY_H_58E0F7C1B741CAD998111EF661857E54
+#define FS_REPLAY_H_58E0F7C1B741CAD998111EF661857E54
+
+#include "enums.h"
+#include "networkmessage.h"
+
+class PropWriteStream;
+class ProtocolGame;
+using ProtocolGame_ptr = std::shared_ptr<ProtocolGame>;
+
+enum ReplayRecordType : uint8_t {
+	REPLAY_RECORD_LOGIN = 1,
+	REPLAY_RECORD_PACKET = 2,
+	REPLAY_RECORD_LOGOUT = 3,
+	REPLAY_RECORD_SCHEDULER = 4,
+};
+
+struct ReplayRecord {
+	uint32_t time; // milliseconds since the recording started
+	uint32_t sessionId;
+	ReplayRecordType type;
+	std::string data; // player name or decoded packet
+	uint32_t accountId;
+	OperatingSystem_t operatingSystem;
+};
+
+/**
+ * Records what enters the game thread, game logins, decoded client packets
+ * and the number of scheduler events fired, together with the seed of the
+ * random generator. A recording can be replayed headless against the same
+ * map and database to get comparable throughput numbers between builds.
+ * The replay runs the scheduler and OTSYS_TIME on a virtual clock that
+ * follows the recorded time, so timers fire as often per simulated minute
+ * as they did while recording, however fast the replay goes. Nothing is
+ * saved to the database while replaying.
+ */
+class Replay
+{
+	public:
+		Replay() = default;
+
+		// non-copyable
+		Replay(const Replay&) = delete;
+		Replay& operator=(const Replay&) = delete;
+
+		bool startRecording(const std::string& fileName);
+		void stopRecording();
+		bool load(const std::string& fileName, double speed);
+
+		bool isRecording() const {
+			return recording;
+		}
+		bool isReplaying() const {
+			return replaying;
+		}
+
+		// starts a new recorded session and returns its id
+		uint32_t recordLogin(const std::string& name, uint32_t accountId, OperatingSystem_t operatingSystem);
+		void recordPacket(uint32_t sessionId, const NetworkMessage& msg);
+		void recordLogout(uint32_t sessionId);
+		void onSchedulerEvents(size_t count);
+
+		// main thread, feeds the recording to the game and blocks until it is done
+		void run();
+
+	private:
+		uint32_t getTime() const;
+		void write(const PropWriteStream& record);
+		void apply(const ReplayRecord& record);
+		void advanceClock(uint32_t time);
+		void waitForDispatcher() const;
+
+		std::chrono::steady_clock::time_point startTime;
+
+		// recording
+		std::mutex recordLock;
+		FILE* file = nullptr;
+		uint32_t lastSessionId = 0;
+		bool recording = false;
+
+		// replaying
+		std::vector<ReplayRecord> records;
+		std::map<uint32_t, ProtocolGame_ptr> sessions;
+		NetworkMessage msg;
+		double speed = 0;
+		int64_t virtualTimeBase = 0;
+		uint64_t recordedSchedulerEvents = 0;
+		std::atomic<uint64_t> replayedSchedulerEvents {0};
+		bool replaying = false;
+};
+
+extern Replay g_replay;
+
+#endif
@@ -20,42 +20,257 @@
 #include "otpch.h"
 
 #include "scheduler.h"
+#include "replay.h"
+
+namespace {
+
+uint32_t findFirstSet(uint64_t word)
+{
+	// de Bruijn bit scan, portable across the compilers we support
+	static constexpr uint8_t positions[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+	};
+	return positions[((word & (~word + 1)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
+
+}
+
+const uint16_t SCHEDULER_TASK_FREE_LIST_CAPACITY = 16384;
+
+void* SchedulerTask::operator new(size_t size)
+{
+	if (size != sizeof(SchedulerTask)) {
+		return ::operator new(size);
+	}
+	return LockfreePoolingAllocator<SchedulerTask, SCHEDULER_TASK_FREE_LIST_CAPACITY>().allocate(1);
+}
+
+void SchedulerTask::operator delete(void* p, size_t size)
+{
+	if (size != sizeof(SchedulerTask)) {
+		::operator delete(p);
+		return;
+	}
+	LockfreePoolingAllocator<SchedulerTask, SCHEDULER_TASK_FREE_LIST_CAPACITY>().deallocate(static_cast<SchedulerTask*>(p), 1);
+}
+
+Scheduler::Scheduler() : epoch(std::chrono::steady_clock::now()) {}
+
+uint64_t Scheduler::toTick(std::chrono::steady_clock::time_point timePoint, bool roundUp) const
+{
+	if (timePoint <= epoch) {
+		return 0;
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(timePoint - epoch).count();
+	if (roundUp) {
+		elapsed += 999;
+	}
+	return elapsed / 1000;
+}
+
+void Scheduler::link(SchedulerTask* task)
+{
+	uint64_t tick = std::max<uint64_t>(task->tick, currentTick);
+	uint64_t delta = std::min<uint64_t>(tick - currentTick, std::numeric_limits<uint32_t>::max());
+	tick = currentTick + delta;
+
+	uint32_t slot;
+	if (delta < WHEEL_ROOT_SIZE) {
+		slot = tick & (WHEEL_ROOT_SIZE - 1);
+	} else {
+		uint32_t level = 1;
+		uint32_t shift = WHEEL_ROOT_BITS;
+		while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (shift + WHEEL_LEVEL_BITS))) {
+			++level;
+			shift += WHEEL_LEVEL_BITS;
+		}
+		slot = WHEEL_ROOT_SIZE + (level - 1) * WHEEL_LEVEL_SIZE + ((tick >> shift) & (WHEEL_LEVEL_SIZE - 1));
+	}
+
+	WheelSlot& wheelSlot = slots[slot];
+	task->slot = slot;
+	task->next = nullptr;
+	task->prev = wheelSlot.tail;
+	if (wheelSlot.tail) {
+		wheelSlot.tail->next = task;
+	} else {
+		wheelSlot.head = task;
+		occupied[slot / 64] |= (1ULL << (slot % 64));
+	}
+	wheelSlot.tail = task;
+}
+
+void Scheduler::unlink(SchedulerTask* task)
+{
+	WheelSlot& wheelSlot = slots[task->slot];
+	if (task->prev) {
+		task->prev->next = task->next;
+	} else {
+		wheelSlot.head = task->next;
+	}
+
+	if (task->next) {
+		task->next->prev = task->prev;
+	} else {
+		wheelSlot.tail = task->prev;
+	}
+
+	if (!wheelSlot.head) {
+		occupied[task->slot / 64] &= ~(1ULL << (task->slot % 64));
+	}
+	task->prev = task->next = nullptr;
+}
+
+void Scheduler::cascade()
+{
+	// called whenever the root level wraps around, pulls the tasks of the
+	// current slot of each higher level down to where they belong now
+	uint32_t shift = WHEEL_ROOT_BITS;
+	for (uint32_t level = 1; level < WHEEL_LEVELS; ++level, shift += WHEEL_LEVEL_BITS) {
+		uint32_t index = (currentTick >> shift) & (WHEEL_LEVEL_SIZE - 1);
+		uint32_t slot = WHEEL_ROOT_SIZE + (level - 1) * WHEEL_LEVEL_SIZE + index;
+
+		WheelSlot& wheelSlot = slots[slot];
+		SchedulerTask* task = wheelSlot.head;
+		wheelSlot.head = wheelSlot.tail = nullptr;
+		occupied[slot / 64] &= ~(1ULL << (slot % 64));
+
+		while (task) {
+			SchedulerTask* next = task->next;
+			link(task);
+			task = next;
+		}
+
+		if (index != 0) {
+			break;
+		}
+	}
+}
+
+void Scheduler::collectExpired(uint64_t nowTick, std::vector<Task*>& expired)
+{
+	while (currentTick <= nowTick) {
+		uint32_t index = currentTick & (WHEEL_ROOT_SIZE - 1);
+		if (index == 0) {
+			cascade();
+		}
+
+		WheelSlot& wheelSlot = slots[index];
+		if (wheelSlot.head) {
+			for (SchedulerTask* task = wheelSlot.head; task; task = task->next) {
+				eventIds.erase(task->getEventId());
+				expired.push_back(task);
+			}
+			wheelSlot.head = wheelSlot.tail = nullptr;
+			occupied[index / 64] &= ~(1ULL << (index % 64));
+		}
+
+		// skip the empty ticks up to the next occupied slot or the next wrap around
+		uint32_t nextIndex = WHEEL_ROOT_SIZE;
+		for (uint32_t i = (index + 1) / 64; i < WHEEL_ROOT_SIZE / 64; ++i) {
+			uint64_t word = occupied[i];
+			if (i == (index + 1) / 64) {
+				word &= ~0ULL << ((index + 1) % 64);
+			}
+
+			if (word != 0) {
+				nextIndex = i * 64 + findFirstSet(word);
+				break;
+			}
+		}
+		currentTick = std::min<uint64_t>(currentTick + (nextIndex - index), nowTick + 1);
+	}
+
+	if (!expired.empty()) {
+		++handoffStats.batches;
+		handoffStats.tasks += expired.size();
+		handoffStats.maxBatchSize = std::max<uint32_t>(handoffStats.maxBatchSize, expired.size());
+	}
+}
+
+uint64_t Scheduler::getNextWakeupTick() const
+{
+	uint32_t index = currentTick & (WHEEL_ROOT_SIZE - 1);
+	for (uint32_t i = index / 64; i < WHEEL_ROOT_SIZE / 64; ++i) {
+		uint64_t word = occupied[i];
+		if (i == index / 64) {
+			word &= ~0ULL << (index % 64);
+		}
+
+		if (word != 0) {
+			return currentTick + (i * 64 + findFirstSet(word) - index);
+		}
+	}
+
+	for (uint64_t word : occupied) {
+		if (word != 0) {
+			// nothing due in this revolution, wake up for the next cascade
+			return (currentTick + WHEEL_ROOT_SIZE - 1) & ~static_cast<uint64_t>(WHEEL_ROOT_SIZE - 1);
+		}
+	}
+	return NO_WAKEUP;
+}
 
 void Scheduler::threadMain()
 {
+	std::vector<Task*> expiredTasks;
 	std::unique_lock<std::mutex> eventLockUnique(eventLock, std::defer_lock);
 	while (getState() != THREAD_STATE_TERMINATED) {
-		std::cv_status ret = std::cv_status::no_timeout;
-
 		eventLockUnique.lock();
-		if (eventList.empty()) {
+
+		nextWakeupTick = getNextWakeupTick();
+		if (nextWakeupTick == NO_WAKEUP || virtualClock) {
+			// on the virtual clock events only expire through advanceClock
 			eventSignal.wait(eventLockUnique);
 		} else {
-			ret = eventSignal.wait_until(eventLockUnique, eventList.top()->getCycle());
+			eventSignal.wait_until(eventLockUnique, epoch + std::chrono::milliseconds(nextWakeupTick));
 		}
 
 		// the mutex is locked again now...
-		if (ret == std::cv_status::timeout) {
-			// ok we had a timeout, so there has to be an event we have to execute...
-			SchedulerTask* task = eventList.top();
-			eventList.pop();
-
-			// check if the event was stopped
-			auto it = eventIds.find(task->getEventId());
-			if (it == eventIds.end()) {
-				eventLockUnique.unlock();
-				delete task;
-				continue;
-			}
-			eventIds.erase(it);
-			eventLockUnique.unlock();
-
-			task->setDontExpire();
-			g_dispatcher.addTask(task, true);
-		} else {
-			eventLockUnique.unlock();
+		if (!virtualClock) {
+			collectExpired(toTick(std::chrono::steady_clock::now(), false), expiredTasks);
 		}
+		nextWakeupTick = NO_WAKEUP;
+		eventLockUnique.unlock();
+
+		handOver(expiredTasks);
+	}
+}
+
+void Scheduler::handOver(std::vector<Task*>& expired)
+{
+	if (expired.empty()) {
+		return;
+	}
+
+	// expired in wheel order, handed over with a single wakeup
+	for (Task* task : expired) {
+		task->setDontExpire();
+	}
+	g_dispatcher.addTasks(expired, true);
+	g_replay.onSchedulerEvents(expired.size());
+	expired.clear();
+}
+
+void Scheduler::advanceClock(uint64_t time)
+{
+	std::vector<Task*> expiredTasks;
+	{
+		std::lock_guard<std::mutex> lockClass(eventLock);
+		virtualTick = std::max(virtualTick, time);
+		collectExpired(virtualTick, expiredTasks);
 	}
+	handOver(expiredTasks);
+}
+
+uint64_t Scheduler::getNextEventTime()
+{
+	std::lock_guard<std::mutex> lockClass(eventLock);
+	return getNextWakeupTick();
 }
 
 uint32_t Scheduler::addEvent(SchedulerTask* task)
@@ -75,14 +290,18 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 		}
 
 		// insert the event id in the list of active events
-		eventIds.insert(task->getEventId());
+		eventIds[task->getEventId()] = task;
 
-		// add the event to the queue
-		eventList.push(task);
+		// add the event to the wheel
+		if (virtualClock) {
+			task->tick = virtualTick + task->delay;
+		} else {
+			task->tick = toTick(task->getCycle(), true);
+		}
+		link(task);
 
-		// if the list was empty or this event is the top in the list
-		// we have to signal it
-		do_signal = (task == eventList.top());
+		// if the scheduler sleeps past this event we have to signal it
+		do_signal = (task->tick < nextWakeupTick);
 	} else {
 		eventLock.unlock();
 		delete task;
@@ -104,15 +323,23 @@ bool Scheduler::stopEvent(uint32_t eventid)
 		return false;
 	}
 
-	std::lock_guard<std::mutex> lockClass(eventLock);
+	SchedulerTask* task;
+	{
+		std::lock_guard<std::mutex> lockClass(eventLock);
 
-	// search the event id..
-	auto it = eventIds.find(eventid);
-	if (it == eventIds.end()) {
-		return false;
+		// search the event id..
+		auto it = eventIds.find(eventid);
+		if (it == eventIds.end()) {
+			return false;
+		}
+
+		task = it->second;
+		eventIds.erase(it);
+		unlink(task);
 	}
 
-	eventIds.erase(it);
+	// release it outside of the lock, its bound arguments may have destructors of their own
+	delete task;
 	return true;
 }
 
@@ -122,17 +349,26 @@ void Scheduler::shutdown()
 	eventLock.lock();
 
 	//this list should already be empty
-	while (!eventList.empty()) {
-		delete eventList.top();
-		eventList.pop();
+	for (WheelSlot& wheelSlot : slots) {
+		SchedulerTask* task = wheelSlot.head;
+		while (task) {
+			SchedulerTask* next = task->next;
+			delete task;
+			task = next;
+		}
+		wheelSlot.head = wheelSlot.tail = nullptr;
 	}
+	occupied.fill(0);
 
 	eventIds.clear();
 	eventLock.unlock();
 	eventSignal.notify_one();
 }
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f)
+SchedulerHandoffStats Scheduler::takeHandoffStats()
 {
-	return new SchedulerTask(delay, std::move(f));
+	std::lock_guard<std::mutex> lockGuard(eventLock);
+	SchedulerHandoffStats stats = handoffStats;
+	handoffStats = SchedulerHandoffStats();
+	return stats;
 }
@@ -21,13 +21,21 @@
 #define FS_SCHEDULER_H_2905B3D5EAB34B4BA8830167262D2DC1
 
 #include "tasks.h"
-#include <unordered_set>
-#include <queue>
+#include <array>
+#include <limits>
+#include <unordered_map>
 
 #include "thread_holder_base.h"
 
 static constexpr int32_t SCHEDULER_MINTICKS = 50;
 
+// Every wakeup hands all expired events to the dispatcher as one batch
+struct SchedulerHandoffStats {
+	uint64_t batches = 0;
+	uint64_t tasks = 0;
+	uint32_t maxBatchSize = 0;
+};
+
 class SchedulerTask : public Task
 {
 	public:
@@ -38,43 +46,126 @@ class SchedulerTask : public Task
 			return eventId;
 		}
 
-		std::chrono::system_clock::time_point getCycle() const {
+		std::chrono::steady_clock::time_point getCycle() const {
 			return expiration;
 		}
 
+		// scheduler tasks have a free list of their own
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
 	protected:
-		SchedulerTask(uint32_t delay, std::function<void (void)>&& f) : Task(delay, std::move(f)) {}
+		template <typename F>
+		SchedulerTask(uint32_t delay, F&& f) : Task(delay, std::forward<F>(f)), delay(delay) {}
 
 		uint32_t eventId = 0;
+		uint32_t delay;
 
-		friend SchedulerTask* createSchedulerTask(uint32_t, std::function<void (void)>);
-};
+		template <typename F>
+		friend SchedulerTask* createSchedulerTask(uint32_t, F&&);
+		template <typename F>
+		friend SchedulerTask* createSchedulerTask(uint32_t, const char*, F&&);
 
-SchedulerTask* createSchedulerTask(uint32_t delay, std::function<void (void)> f);
+	private:
+		// intrusive links into the timing wheel slot holding this task
+		SchedulerTask* prev = nullptr;
+		SchedulerTask* next = nullptr;
+		uint64_t tick = 0;
+		uint16_t slot = 0;
 
-struct TaskComparator {
-	bool operator()(const SchedulerTask* lhs, const SchedulerTask* rhs) const {
-		return lhs->getCycle() > rhs->getCycle();
-	}
+		friend class Scheduler;
 };
 
+template <typename F>
+SchedulerTask* createSchedulerTask(uint32_t delay, F&& f)
+{
+	return new SchedulerTask(delay, std::forward<F>(f));
+}
+
+template <typename F>
+SchedulerTask* createSchedulerTask(uint32_t delay, const char* tag, F&& f)
+{
+	SchedulerTask* task = new SchedulerTask(delay, std::forward<F>(f));
+	task->setTag(tag);
+	return task;
+}
+
+/**
+ * Events are kept in a hierarchical timing wheel with a resolution of one
+ * millisecond. The first level has 256 slots, one per tick, each following
+ * level has 64 slots covering a whole revolution of the level below, which
+ * is enough to hold any uint32_t delay. Tasks are linked intrusively into
+ * their slot, so adding and stopping an event never searches or reorders,
+ * and stopped events are released right away.
+ */
 class Scheduler : public ThreadHolder<Scheduler>
 {
 	public:
+		Scheduler();
+
 		uint32_t addEvent(SchedulerTask* task);
 		bool stopEvent(uint32_t eventId);
 
 		void shutdown();
 
+		// returns the handoff counters gathered since the previous call
+		SchedulerHandoffStats takeHandoffStats();
+
+		/**
+		  * Used by replays, has to be called before the scheduler starts. Events
+		  * are then only handed to the dispatcher by advanceClock, and their delay
+		  * counts from the virtual time the clock was last advanced to.
+		  */
+		void useVirtualClock() {
+			virtualClock = true;
+		}
+		// virtual clock only, time in milliseconds since the clock started
+		void advanceClock(uint64_t time);
+		// virtual clock only, the time advanceClock has to reach for anything to happen
+		uint64_t getNextEventTime();
+
 		void threadMain();
+
 	protected:
+		static constexpr uint32_t WHEEL_LEVELS = 5;
+		static constexpr uint32_t WHEEL_ROOT_BITS = 8;
+		static constexpr uint32_t WHEEL_LEVEL_BITS = 6;
+		static constexpr uint32_t WHEEL_ROOT_SIZE = 1 << WHEEL_ROOT_BITS;
+		static constexpr uint32_t WHEEL_LEVEL_SIZE = 1 << WHEEL_LEVEL_BITS;
+		static constexpr uint32_t WHEEL_SLOTS = WHEEL_ROOT_SIZE + (WHEEL_LEVELS - 1) * WHEEL_LEVEL_SIZE;
+		static constexpr uint64_t NO_WAKEUP = std::numeric_limits<uint64_t>::max();
+
+		struct WheelSlot {
+			SchedulerTask* head = nullptr;
+			SchedulerTask* tail = nullptr;
+		};
+
+		uint64_t toTick(std::chrono::steady_clock::time_point timePoint, bool roundUp) const;
+
+		void link(SchedulerTask* task);
+		void unlink(SchedulerTask* task);
+		void cascade();
+		void collectExpired(uint64_t nowTick, std::vector<Task*>& expired);
+		void handOver(std::vector<Task*>& expired);
+		uint64_t getNextWakeupTick() const;
+
 		std::thread thread;
 		std::mutex eventLock;
 		std::condition_variable eventSignal;
 
 		uint32_t lastEventId {0};
-		std::priority_queue<SchedulerTask*, std::deque<SchedulerTask*>, TaskComparator> eventList;
-		std::unordered_set<uint32_t> eventIds;
+		std::unordered_map<uint32_t, SchedulerTask*> eventIds;
+
+		std::chrono::steady_clock::time_point epoch;
+		uint64_t currentTick = 0;
+		uint64_t nextWakeupTick = NO_WAKEUP;
+		std::array<WheelSlot, WHEEL_SLOTS> slots;
+		std::array<uint64_t, WHEEL_SLOTS / 64> occupied {};
+
+		SchedulerHandoffStats handoffStats;
+
+		bool virtualClock = false;
+		uint64_t virtualTick = 0;
 };
 
 extern Scheduler g_scheduler;
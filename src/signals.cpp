@@ -84,17 +84,17 @@ void Signals::dispatchSignalHandler(int signal)
 {
 	switch(signal) {
 		case SIGINT: //Shuts the server down
-			g_dispatcher.addTask(createTask(sigintHandler));
+			g_dispatcher.addTask(createTask("sigintHandler", sigintHandler));
 			break;
 		case SIGTERM: //Shuts the server down
-			g_dispatcher.addTask(createTask(sigtermHandler));
+			g_dispatcher.addTask(createTask("sigtermHandler", sigtermHandler));
 			break;
 #ifndef _WIN32
 		case SIGHUP: //Reload config/data
-			g_dispatcher.addTask(createTask(sighupHandler));
+			g_dispatcher.addTask(createTask("sighupHandler", sighupHandler));
 			break;
 		case SIGUSR1: //Saves game state
-			g_dispatcher.addTask(createTask(sigusr1Handler));
+			g_dispatcher.addTask(createTask("sigusr1Handler", sigusr1Handler));
 			break;
 #endif
 		default:
@@ -158,14 +158,14 @@ bool Spawns::isInZone(const Position& centerPos, int32_t radius, const Position&
 		return true;
 	}
 
-	return ((pos.getX() >= centerPos.getX() - radius) && (pos.getX() <= centerPos.getX() + radius) &&
-	        (pos.getY() >= centerPos.getY() - radius) && (pos.getY() <= centerPos.getY() + radius));
+	// the zone spans every floor, only the square around the center matters
+	return SpatialArea::square(centerPos, radius, 0, MAP_MAX_LAYERS - 1).contains(pos);
 }
 
 void Spawn::startSpawnCheck()
 {
 	if (checkSpawnEvent == 0) {
-		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this)));
+		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), "Spawn::checkSpawn", std::bind(&Spawn::checkSpawn, this)));
 	}
 }
 
@@ -180,14 +180,10 @@ Spawn::~Spawn()
 
 bool Spawn::findPlayer(const Position& pos)
 {
-	SpectatorHashSet spectators;
-	g_game.map.getSpectators(spectators, pos, false, true);
-	for (Creature* spectator : spectators) {
-		if (!spectator->getPlayer()->hasFlag(PlayerFlag_IgnoredByMonsters)) {
-			return true;
-		}
-	}
-	return false;
+	const SpatialArea area = SpatialArea::viewport(pos, -Map::maxViewportX, Map::maxViewportX, -Map::maxViewportY, Map::maxViewportY, pos.z, pos.z);
+	return !g_game.map.queryCreatures(area, SPATIALFILTER_PLAYERS, [](Creature* creature) {
+		return creature->getPlayer()->hasFlag(PlayerFlag_IgnoredByMonsters);
+	});
 }
 
 bool Spawn::isInSpawnZone(const Position& pos)
@@ -258,7 +254,7 @@ void Spawn::checkSpawn()
 	}
 
 	if (spawnedMap.size() < spawnMap.size()) {
-		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this)));
+		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), "Spawn::checkSpawn", std::bind(&Spawn::checkSpawn, this)));
 	}
 }
 
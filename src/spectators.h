@@ -0,0 +1,166 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_SPECTATORS_H_DDD98027864D6FDFED6CA36CC3DE09B9
+#define FS_SPECTATORS_H_DDD98027864D6FDFED6CA36CC3DE09B9
+
+#include <algorithm>
+#include <memory>
+#include <unordered_set>
+
+class Creature;
+
+/**
+  * Result of Map::getSpectators. The first INLINE_CAPACITY creatures are kept
+  * inside the object, so the usual broadcast does not touch the heap.
+  *
+  * A single map scan never yields a creature twice (QTree leaves do not
+  * overlap), so emplace_back does not look for duplicates; addSpectators does,
+  * for callers merging the spectators of several positions.
+  */
+class SpectatorVec
+{
+	public:
+		using iterator = Creature**;
+		using const_iterator = Creature* const*;
+
+		static constexpr size_t INLINE_CAPACITY = 32;
+
+		SpectatorVec() = default;
+		SpectatorVec(const SpectatorVec& other) {
+			append(other);
+		}
+		SpectatorVec(SpectatorVec&& other) {
+			*this = std::move(other);
+		}
+
+		SpectatorVec& operator=(const SpectatorVec& other) {
+			if (this != &other) {
+				count = 0;
+				append(other);
+			}
+			return *this;
+		}
+		SpectatorVec& operator=(SpectatorVec&& other) {
+			if (this == &other) {
+				return *this;
+			}
+
+			if (other.heapStorage) {
+				heapStorage = std::move(other.heapStorage);
+				data = heapStorage.get();
+				capacity = other.capacity;
+				count = other.count;
+
+				other.data = other.inlineStorage;
+				other.capacity = INLINE_CAPACITY;
+			} else {
+				count = 0;
+				append(other);
+			}
+			other.count = 0;
+			return *this;
+		}
+
+		iterator begin() {
+			return data;
+		}
+		const_iterator begin() const {
+			return data;
+		}
+		iterator end() {
+			return data + count;
+		}
+		const_iterator end() const {
+			return data + count;
+		}
+
+		size_t size() const {
+			return count;
+		}
+		bool empty() const {
+			return count == 0;
+		}
+		void clear() {
+			count = 0;
+		}
+
+		void emplace_back(Creature* spectator) {
+			if (count == capacity) {
+				grow();
+			}
+			data[count++] = spectator;
+		}
+
+		void addSpectators(const SpectatorVec& spectators) {
+			if (empty()) {
+				*this = spectators;
+				return;
+			}
+
+			size_t oldCount = count;
+			if (oldCount + spectators.size() <= INLINE_CAPACITY) {
+				// scanning at most INLINE_CAPACITY pointers beats building a set
+				for (Creature* spectator : spectators) {
+					if (std::find(data, data + oldCount, spectator) == data + oldCount) {
+						emplace_back(spectator);
+					}
+				}
+				return;
+			}
+
+			std::unordered_set<Creature*> known(data, data + oldCount);
+			for (Creature* spectator : spectators) {
+				if (known.insert(spectator).second) {
+					emplace_back(spectator);
+				}
+			}
+		}
+
+		// does not keep the order of the remaining spectators
+		void erase(Creature* spectator) {
+			iterator it = std::find(begin(), end(), spectator);
+			if (it != end()) {
+				*it = data[--count];
+			}
+		}
+
+	private:
+		void append(const SpectatorVec& other) {
+			for (Creature* spectator : other) {
+				emplace_back(spectator);
+			}
+		}
+
+		void grow() {
+			capacity *= 2;
+			Creature** newStorage = new Creature*[capacity];
+			std::copy(data, data + count, newStorage);
+			heapStorage.reset(newStorage);
+			data = newStorage;
+		}
+
+		Creature* inlineStorage[INLINE_CAPACITY];
+		std::unique_ptr<Creature*[]> heapStorage;
+		Creature** data = inlineStorage;
+		size_t count = 0;
+		size_t capacity = INLINE_CAPACITY;
+};
+
+#endif
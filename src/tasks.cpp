@@ -20,89 +20,434 @@
 #include "otpch.h"
 
 #include "tasks.h"
-#include "game.h"
+#include "scheduler.h"
 
-extern Game g_game;
+namespace {
 
-Task* createTask(std::function<void (void)> f)
+const char* const tickCategoryNames[TICK_CATEGORY_LAST] = {
+	"idle", "other", "network", "creatures", "decay", "lua", "output"
+};
+
+const int64_t DEFAULT_TICK_STATS_WINDOW = 60;
+const size_t TASK_PROFILE_REPORT_SIZE = 10;
+
+const char* getTaskTag(const char* tag)
+{
+	return tag ? tag : "untagged";
+}
+
+}
+
+void TaskLatencyHistogram::record(int64_t value)
+{
+	value = std::max<int64_t>(0, std::min<int64_t>(value, (1LL << (MAX_EXPONENT + 1)) - 1));
+
+	uint32_t index;
+	if (value < SUB_BUCKETS) {
+		index = value;
+	} else {
+		uint32_t exponent = SUB_BUCKET_BITS;
+		while ((value >> (exponent + 1)) != 0) {
+			++exponent;
+		}
+		index = (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+	}
+
+	++buckets[index];
+	++count;
+	total += value;
+	max = std::max(max, value);
+}
+
+int64_t TaskLatencyHistogram::getValueAtPercentile(double percentile) const
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(count * percentile / 100.)));
+	uint64_t seen = 0;
+	for (uint32_t index = 0; index < BUCKETS; ++index) {
+		seen += buckets[index];
+		if (seen < rank) {
+			continue;
+		}
+
+		if (index < SUB_BUCKETS) {
+			return index;
+		}
+
+		// highest value that falls into this bucket
+		uint32_t shift = index / SUB_BUCKETS - 1;
+		int64_t value = static_cast<int64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+		return std::min<int64_t>(max, value + (1LL << shift) - 1);
+	}
+	return max;
+}
+
+const uint16_t TASK_FREE_LIST_CAPACITY = 4096;
+
+void* Task::operator new(size_t size)
 {
-	return new Task(std::move(f));
+	if (size != sizeof(Task)) {
+		return ::operator new(size);
+	}
+	return LockfreePoolingAllocator<Task, TASK_FREE_LIST_CAPACITY>().allocate(1);
 }
 
-Task* createTask(uint32_t expiration, std::function<void (void)> f)
+void Task::operator delete(void* p, size_t size)
 {
-	return new Task(expiration, std::move(f));
+	if (size != sizeof(Task)) {
+		::operator delete(p);
+		return;
+	}
+	LockfreePoolingAllocator<Task, TASK_FREE_LIST_CAPACITY>().deallocate(static_cast<Task*>(p), 1);
 }
 
 void Dispatcher::threadMain()
 {
-	// NOTE: second argument defer_lock is to prevent from immediate locking
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+	Task* priorityTasks = nullptr;
+	Task* tasks = nullptr;
 
-	while (getState() != THREAD_STATE_TERMINATED) {
-		// check if there are tasks waiting
-		taskLockUnique.lock();
+	threadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	tickCategoryStart = tickSliceStart = tickStatsStart = std::chrono::steady_clock::now();
 
-		if (taskList.empty()) {
-			//if the list is empty wait for signal
-			taskSignal.wait(taskLockUnique);
+	while (getState() != THREAD_STATE_TERMINATED) {
+		if (!priorityTasks) {
+			priorityTasks = priorityTaskQueue.drain();
 		}
 
-		if (!taskList.empty()) {
-			// take the first task
-			Task* task = taskList.front();
-			taskList.pop_front();
-			taskLockUnique.unlock();
+		Task* task;
+		if (priorityTasks) {
+			task = priorityTasks;
+			priorityTasks = task->next;
+		} else {
+			if (!tasks) {
+				tasks = taskQueue.drain();
+				if (!tasks) {
+					waitForTasks();
+					continue;
+				}
+			}
 
-			if (!task->hasExpired()) {
-				++dispatcherCycle;
-				// execute it
-				(*task)();
+			task = tasks;
+			tasks = task->next;
+		}
 
-				g_game.map.clearSpectatorCache();
+		if (!task->hasExpired()) {
+			++dispatcherCycle;
+			// execute it
+			setTickCategory(task->tickCategory);
+			if (profileTasks.load(std::memory_order_relaxed)) {
+				executeProfiled(task);
+			} else {
+				(*task)();
 			}
-			delete task;
-		} else {
-			taskLockUnique.unlock();
+
+			setTickCategory(TICK_CATEGORY_OTHER);
+		}
+		delete task;
+	}
+
+	// release whatever was still queued when we got terminated
+	for (Task* chain : {priorityTasks, tasks}) {
+		while (chain) {
+			Task* next = chain->next;
+			delete chain;
+			chain = next;
+		}
+	}
+
+	// pairs with the check after the push in addTask: a producer either sees
+	// the terminated state and releases its task itself, or the drain below
+	// sees its task
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	releaseQueuedTasks();
+}
+
+void Dispatcher::releaseQueuedTasks()
+{
+	for (Task* chain : {priorityTaskQueue.drain(), taskQueue.drain()}) {
+		while (chain) {
+			Task* next = chain->next;
+			delete chain;
+			chain = next;
 		}
 	}
 }
 
+void Dispatcher::waitForTasks()
+{
+	std::unique_lock<std::mutex> taskLockUnique(taskLock);
+	sleeping.store(true);
+
+	// a producer either sees us sleeping and signals, or we see its task here
+	if (taskQueue.empty() && priorityTaskQueue.empty()) {
+		setTickCategory(TICK_CATEGORY_IDLE);
+		taskSignal.wait(taskLockUnique);
+		setTickCategory(TICK_CATEGORY_OTHER);
+	}
+
+	sleeping.store(false, std::memory_order_relaxed);
+}
+
+void Dispatcher::executeProfiled(Task* task)
+{
+	taskTickTime.fill(0);
+
+	auto start = std::chrono::steady_clock::now();
+	(*task)();
+	setTickCategory(task->tickCategory);
+	auto end = std::chrono::steady_clock::now();
+
+	TaskProfile& profile = taskProfiles[task->tag];
+	int64_t executionTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	profile.executionTime.record(executionTime);
+
+	int64_t waitTime = -1;
+	if (task->queuedAt != TASK_TIME_ZERO) {
+		waitTime = std::chrono::duration_cast<std::chrono::microseconds>(start - task->queuedAt).count();
+		profile.waitTime.record(waitTime);
+	}
+
+	if (executionTime < slowTaskThreshold * 1000) {
+		return;
+	}
+
+	std::ostringstream ss;
+	ss << "[Warning - Dispatcher] Slow task " << getTaskTag(task->tag) << " took " << executionTime / 1000 << " ms";
+	if (waitTime >= 0) {
+		ss << " after waiting " << waitTime / 1000 << " ms";
+	}
+
+	// where inside the task the time went, e.g. lua called from a creature think
+	char separator = ':';
+	for (uint8_t category = TICK_CATEGORY_OTHER; category < TICK_CATEGORY_LAST; ++category) {
+		if (taskTickTime[category] >= 1000) {
+			ss << separator << ' ' << tickCategoryNames[category] << ' ' << taskTickTime[category] / 1000 << " ms";
+			separator = ',';
+		}
+	}
+	ss << " (p99 " << profile.executionTime.getValueAtPercentile(99) / 1000 << " ms over " << profile.executionTime.getCount() << " runs)";
+	std::cout << ss.str() << std::endl;
+}
+
+TickCategory Dispatcher::setTickCategory(TickCategory category)
+{
+	// the tick accounting is not synchronized, time spent on other threads
+	// (e.g. Lua called while the map loads in parallel) is not accounted
+	if (!isDispatcherThread()) {
+		return category;
+	}
+
+	TickCategory previous = tickCategory;
+	tickCategory = category;
+	if (!tickAccounting) {
+		return previous;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - tickCategoryStart).count();
+	tickStats.time[previous] += elapsed;
+	taskTickTime[previous] += elapsed;
+	if (previous != TICK_CATEGORY_IDLE) {
+		tickSliceBusyTime += elapsed;
+	}
+	tickCategoryStart = now;
+
+	if (now - tickSliceStart >= std::chrono::milliseconds(SCHEDULER_MINTICKS)) {
+		closeTickSlice(now);
+	}
+	return previous;
+}
+
+void Dispatcher::setTickReporting(int64_t reportInterval, int64_t slowTaskThreshold)
+{
+	tickReportInterval = reportInterval;
+	this->slowTaskThreshold = slowTaskThreshold;
+	profileTasks.store(slowTaskThreshold > 0, std::memory_order_relaxed);
+
+	bool enabled = reportInterval > 0 || slowTaskThreshold > 0;
+	if (enabled && !tickAccounting) {
+		// nothing was accounted while it was off, start a new window
+		tickCategoryStart = tickSliceStart = tickStatsStart = std::chrono::steady_clock::now();
+		tickSliceBusyTime = 0;
+		tickStats = DispatcherTickStats();
+		taskProfiles.clear();
+	}
+	tickAccounting = enabled;
+}
+
+void Dispatcher::closeTickSlice(std::chrono::steady_clock::time_point now)
+{
+	// time is charged when the category changes, so a long running task
+	// may have spanned several slices by the time we get here
+	const int64_t sliceTime = SCHEDULER_MINTICKS * 1000;
+	int64_t slices = std::chrono::duration_cast<std::chrono::microseconds>(now - tickSliceStart).count() / sliceTime;
+
+	tickStats.slices += slices;
+	tickStats.overloadedSlices += std::min<int64_t>(slices, tickSliceBusyTime / sliceTime);
+	tickStats.maxSliceBusyTime = std::max<int64_t>(tickStats.maxSliceBusyTime, tickSliceBusyTime / slices);
+	tickSliceBusyTime = 0;
+	tickSliceStart += std::chrono::microseconds(slices * sliceTime);
+
+	if (now - tickStatsStart < std::chrono::seconds(tickReportInterval > 0 ? tickReportInterval : DEFAULT_TICK_STATS_WINDOW)) {
+		return;
+	}
+
+	tickStats.duration = std::chrono::duration_cast<std::chrono::microseconds>(now - tickStatsStart).count();
+
+	SchedulerHandoffStats handoffStats = g_scheduler.takeHandoffStats();
+	tickStats.scheduledBatches = handoffStats.batches;
+	tickStats.scheduledTasks = handoffStats.tasks;
+	tickStats.maxScheduledBatch = handoffStats.maxBatchSize;
+
+	lastTickStats = tickStats;
+	tickStats = DispatcherTickStats();
+	tickStatsStart = now;
+
+	lastTaskProfiles.clear();
+	lastTaskProfiles.swap(taskProfiles);
+
+	if (tickReportInterval > 0) {
+		reportTickStats();
+		reportTaskProfiles();
+	}
+}
+
+void Dispatcher::reportTickStats() const
+{
+	const DispatcherTickStats& stats = lastTickStats;
+	if (stats.duration <= 0) {
+		return;
+	}
+
+	int64_t busyTime = 0;
+	for (uint8_t category = TICK_CATEGORY_OTHER; category < TICK_CATEGORY_LAST; ++category) {
+		busyTime += stats.time[category];
+	}
+
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << "> Dispatcher tick budget (last " << stats.duration / 1000000 << "s): " << (busyTime * 100.) / stats.duration << "% busy";
+	for (uint8_t category = TICK_CATEGORY_OTHER; category < TICK_CATEGORY_LAST; ++category) {
+		ss << ", " << tickCategoryNames[category] << ' ' << (stats.time[category] * 100.) / stats.duration << '%';
+	}
+	ss << "; busiest slice " << stats.maxSliceBusyTime / 1000 << " ms, " << stats.overloadedSlices << " of " << stats.slices << " slices over budget";
+	if (stats.scheduledBatches != 0) {
+		ss << "; " << stats.scheduledTasks << " scheduled events in " << stats.scheduledBatches << " batches (avg "
+		   << static_cast<double>(stats.scheduledTasks) / stats.scheduledBatches << ", max " << stats.maxScheduledBatch << ')';
+	}
+	ss << '.';
+	std::cout << ss.str() << std::endl;
+
+	for (const auto& reporter : tickReporters) {
+		reporter();
+	}
+}
+
+void Dispatcher::reportTaskProfiles() const
+{
+	std::vector<std::pair<const char*, const TaskProfile*>> profiles;
+	profiles.reserve(lastTaskProfiles.size());
+	for (const auto& it : lastTaskProfiles) {
+		profiles.emplace_back(it.first, &it.second);
+	}
+
+	// the tags that cost the most in total
+	size_t size = std::min(profiles.size(), TASK_PROFILE_REPORT_SIZE);
+	std::partial_sort(profiles.begin(), profiles.begin() + size, profiles.end(), [](const std::pair<const char*, const TaskProfile*>& lhs, const std::pair<const char*, const TaskProfile*>& rhs) {
+		return lhs.second->executionTime.getTotal() > rhs.second->executionTime.getTotal();
+	});
+
+	for (size_t i = 0; i < size; ++i) {
+		const TaskLatencyHistogram& execution = profiles[i].second->executionTime;
+		const TaskLatencyHistogram& wait = profiles[i].second->waitTime;
+		std::cout << ">> " << getTaskTag(profiles[i].first) << ": " << execution.getCount() << " runs, " << execution.getTotal() / 1000 << " ms total"
+		          << ", execution p50 " << execution.getValueAtPercentile(50) << " us p99 " << execution.getValueAtPercentile(99) << " us max " << execution.getMax() << " us"
+		          << ", wait p50 " << wait.getValueAtPercentile(50) << " us p99 " << wait.getValueAtPercentile(99) << " us max " << wait.getMax() << " us" << std::endl;
+	}
+}
+
 void Dispatcher::addTask(Task* task, bool push_front /*= false*/)
 {
-	bool do_signal = false;
+	if (getState() != THREAD_STATE_RUNNING) {
+		delete task;
+		return;
+	}
 
-	taskLock.lock();
+	if (profileTasks.load(std::memory_order_relaxed)) {
+		task->queuedAt = std::chrono::steady_clock::now();
+	}
 
-	if (getState() == THREAD_STATE_RUNNING) {
-		do_signal = taskList.empty();
+	if (push_front) {
+		priorityTaskQueue.push(task);
+	} else {
+		taskQueue.push(task);
+	}
 
-		if (push_front) {
-			taskList.push_front(task);
-		} else {
-			taskList.push_back(task);
+	// the dispatcher may have drained the queues for the last time since the check above
+	if (getState(std::memory_order_seq_cst) == THREAD_STATE_TERMINATED) {
+		releaseQueuedTasks();
+		return;
+	}
+
+	if (sleeping.load()) {
+		std::lock_guard<std::mutex> lockClass(taskLock);
+		taskSignal.notify_one();
+	}
+}
+
+void Dispatcher::addTasks(const std::vector<Task*>& tasks, bool push_front /*= false*/)
+{
+	if (tasks.empty()) {
+		return;
+	}
+
+	if (getState() != THREAD_STATE_RUNNING) {
+		for (Task* task : tasks) {
+			delete task;
 		}
+		return;
+	}
+
+	if (profileTasks.load(std::memory_order_relaxed)) {
+		auto now = std::chrono::steady_clock::now();
+		for (Task* task : tasks) {
+			task->queuedAt = now;
+		}
+	}
+
+	// the queue hands out what was pushed last first, link the batch backwards
+	for (size_t i = tasks.size() - 1; i > 0; --i) {
+		tasks[i]->next = tasks[i - 1];
+	}
+
+	if (push_front) {
+		priorityTaskQueue.pushChain(tasks.back(), tasks.front());
 	} else {
-		delete task;
+		taskQueue.pushChain(tasks.back(), tasks.front());
 	}
 
-	taskLock.unlock();
+	if (getState(std::memory_order_seq_cst) == THREAD_STATE_TERMINATED) {
+		releaseQueuedTasks();
+		return;
+	}
 
-	// send a signal if the list was empty
-	if (do_signal) {
+	if (sleeping.load()) {
+		std::lock_guard<std::mutex> lockClass(taskLock);
 		taskSignal.notify_one();
 	}
 }
 
 void Dispatcher::shutdown()
 {
-	Task* task = createTask([this]() {
+	Task* task = createTask("Dispatcher::shutdown", [this]() {
 		setState(THREAD_STATE_TERMINATED);
-		taskSignal.notify_one();
 	});
 
-	std::lock_guard<std::mutex> lockClass(taskLock);
-	taskList.push_back(task);
+	taskQueue.push(task);
 
+	std::lock_guard<std::mutex> lockClass(taskLock);
 	taskSignal.notify_one();
 }
@@ -20,51 +20,234 @@
 #ifndef FS_TASKS_H_A66AC384766041E59DCA059DAB6E1976
 #define FS_TASKS_H_A66AC384766041E59DCA059DAB6E1976
 
+#include <array>
 #include <condition_variable>
 #include "thread_holder_base.h"
 #include "enums.h"
+#include "lockfree.h"
 
 const int DISPATCHER_TASK_EXPIRATION = 2000;
-const auto SYSTEM_TIME_ZERO = std::chrono::system_clock::time_point(std::chrono::milliseconds(0));
+const auto TASK_TIME_ZERO = std::chrono::steady_clock::time_point(std::chrono::milliseconds(0));
+
+// What the dispatcher is busy with, used to account where the tick budget goes
+enum TickCategory : uint8_t {
+	TICK_CATEGORY_IDLE,
+	TICK_CATEGORY_OTHER,
+	TICK_CATEGORY_NETWORK,
+	TICK_CATEGORY_CREATURES,
+	TICK_CATEGORY_DECAY,
+	TICK_CATEGORY_LUA,
+	TICK_CATEGORY_OUTPUT,
+
+	TICK_CATEGORY_LAST /* this must be the last one */
+};
+
+struct DispatcherTickStats {
+	std::array<int64_t, TICK_CATEGORY_LAST> time {}; // microseconds spent in each category
+	int64_t duration = 0; // microseconds covered by these stats
+	int64_t maxSliceBusyTime = 0; // microseconds of the busiest scheduler slice
+	uint32_t slices = 0;
+	uint32_t overloadedSlices = 0; // slices the dispatcher spent busy from start to end
+	uint64_t scheduledBatches = 0; // batches of expired events handed over by the scheduler
+	uint64_t scheduledTasks = 0;
+	uint32_t maxScheduledBatch = 0;
+};
+
+// Log-linear histogram of durations in microseconds in the spirit of
+// HdrHistogram, every power of two is split into 8 buckets so any recorded
+// value is reported within 12.5% of its real value.
+class TaskLatencyHistogram
+{
+	public:
+		void record(int64_t value);
+		int64_t getValueAtPercentile(double percentile) const;
+
+		uint64_t getCount() const {
+			return count;
+		}
+		int64_t getTotal() const {
+			return total;
+		}
+		int64_t getMax() const {
+			return max;
+		}
+
+	private:
+		static constexpr uint32_t SUB_BUCKET_BITS = 3;
+		static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+		static constexpr uint32_t MAX_EXPONENT = 40;
+		static constexpr uint32_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+		std::array<uint32_t, BUCKETS> buckets {};
+		uint64_t count = 0;
+		int64_t total = 0;
+		int64_t max = 0;
+};
+
+struct TaskProfile {
+	TaskLatencyHistogram waitTime;
+	TaskLatencyHistogram executionTime;
+};
+
+// Holds the closure of a task. Closures up to INLINE_STORAGE_SIZE bytes are
+// stored in place, which covers the std::bind expressions used for game
+// tasks, bigger ones fall back to the heap.
+class TaskFunction
+{
+	public:
+		static constexpr size_t INLINE_STORAGE_SIZE = 96;
+
+		template <typename F>
+		explicit TaskFunction(F&& f) {
+			using Callable = typename std::decay<F>::type;
+			construct<Callable>(std::forward<F>(f), std::integral_constant<bool,
+				sizeof(Callable) <= INLINE_STORAGE_SIZE && alignof(Callable) <= alignof(Storage)>());
+		}
+		~TaskFunction() {
+			handler(&storage, false);
+		}
+
+		// non-copyable
+		TaskFunction(const TaskFunction&) = delete;
+		TaskFunction& operator=(const TaskFunction&) = delete;
+
+		void operator()() {
+			handler(&storage, true);
+		}
+
+	private:
+		using Storage = typename std::aligned_storage<INLINE_STORAGE_SIZE>::type;
+
+		template <typename Callable, typename F>
+		void construct(F&& f, std::true_type) {
+			new (&storage) Callable(std::forward<F>(f));
+			handler = &inlineHandler<Callable>;
+		}
+
+		template <typename Callable, typename F>
+		void construct(F&& f, std::false_type) {
+			*reinterpret_cast<Callable**>(&storage) = new Callable(std::forward<F>(f));
+			handler = &heapHandler<Callable>;
+		}
+
+		template <typename Callable>
+		static void inlineHandler(void* p, bool invoke) {
+			Callable* callable = static_cast<Callable*>(p);
+			if (invoke) {
+				(*callable)();
+			} else {
+				callable->~Callable();
+			}
+		}
+
+		template <typename Callable>
+		static void heapHandler(void* p, bool invoke) {
+			Callable* callable = *static_cast<Callable**>(p);
+			if (invoke) {
+				(*callable)();
+			} else {
+				delete callable;
+			}
+		}
+
+		Storage storage;
+		void (*handler)(void*, bool);
+};
 
 class Task
 {
 	public:
 		// DO NOT allocate this class on the stack
-		explicit Task(std::function<void (void)>&& f) : func(std::move(f)) {}
-		Task(uint32_t ms, std::function<void (void)>&& f) :
-			expiration(std::chrono::system_clock::now() + std::chrono::milliseconds(ms)), func(std::move(f)) {}
+		template <typename F>
+		explicit Task(F&& f) : func(std::forward<F>(f)) {}
+		template <typename F>
+		Task(uint32_t ms, F&& f) :
+			expiration(std::chrono::steady_clock::now() + std::chrono::milliseconds(ms)), func(std::forward<F>(f)) {}
 
 		virtual ~Task() = default;
+
+		// non-copyable
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		// tasks are recycled through a lock-free free list
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
 		void operator()() {
 			func();
 		}
 
+		void setTickCategory(TickCategory category) {
+			tickCategory = category;
+		}
+
+		// call site tag used by the task profiler, must be a string with static storage
+		void setTag(const char* tag) {
+			this->tag = tag;
+		}
+
 		void setDontExpire() {
-			expiration = SYSTEM_TIME_ZERO;
+			expiration = TASK_TIME_ZERO;
 		}
 
 		bool hasExpired() const {
-			if (expiration == SYSTEM_TIME_ZERO) {
+			if (expiration == TASK_TIME_ZERO) {
 				return false;
 			}
-			return expiration < std::chrono::system_clock::now();
+			return expiration < std::chrono::steady_clock::now();
 		}
 
 	protected:
 		// Expiration has another meaning for scheduler tasks,
 		// then it is the time the task should be added to the
 		// dispatcher
-		std::chrono::system_clock::time_point expiration = SYSTEM_TIME_ZERO;
-		std::function<void (void)> func;
+		std::chrono::steady_clock::time_point expiration = TASK_TIME_ZERO;
+		TaskFunction func;
+
+	private:
+		// link used while the task is queued in the dispatcher
+		Task* next = nullptr;
+		TickCategory tickCategory = TICK_CATEGORY_OTHER;
+		const char* tag = nullptr;
+		std::chrono::steady_clock::time_point queuedAt = TASK_TIME_ZERO;
+
+		friend class Dispatcher;
 };
 
-Task* createTask(std::function<void (void)> f);
-Task* createTask(uint32_t expiration, std::function<void (void)> f);
+template <typename F>
+Task* createTask(F&& f)
+{
+	return new Task(std::forward<F>(f));
+}
+
+template <typename F>
+Task* createTask(uint32_t expiration, F&& f)
+{
+	return new Task(expiration, std::forward<F>(f));
+}
+
+template <typename F>
+Task* createTask(const char* tag, F&& f)
+{
+	Task* task = new Task(std::forward<F>(f));
+	task->setTag(tag);
+	return task;
+}
+
+template <typename F>
+Task* createTask(uint32_t expiration, const char* tag, F&& f)
+{
+	Task* task = new Task(expiration, std::forward<F>(f));
+	task->setTag(tag);
+	return task;
+}
 
 class Dispatcher : public ThreadHolder<Dispatcher> {
 	public:
 		void addTask(Task* task, bool push_front = false);
+		// queues the tasks in order with a single wakeup
+		void addTasks(const std::vector<Task*>& tasks, bool push_front = false);
 
 		void shutdown();
 
@@ -72,17 +255,92 @@ class Dispatcher : public ThreadHolder<Dispatcher> {
 			return dispatcherCycle;
 		}
 
+		bool isDispatcherThread() const {
+			return std::this_thread::get_id() == threadId.load(std::memory_order_relaxed);
+		}
+
+		// returns the category that was active before, does nothing when
+		// called from another thread or while the tick accounting is off
+		TickCategory setTickCategory(TickCategory category);
+
+		// dispatcher thread only, the tick accounting runs while either the
+		// report interval (seconds) or the slow task threshold (ms) is set
+		void setTickReporting(int64_t reportInterval, int64_t slowTaskThreshold);
+
+		// dispatcher thread only, the reporter is called after each tick report
+		// to add the stats of another subsystem
+		void addTickReporter(std::function<void()> reporter) {
+			tickReporters.push_back(std::move(reporter));
+		}
+
+		// tick budget spent during the last completed report window
+		const DispatcherTickStats& getTickStats() const {
+			return lastTickStats;
+		}
+
+		// queue wait and execution time per task tag during the last completed
+		// report window, only collected while slowTaskThreshold is set
+		const std::unordered_map<const char*, TaskProfile>& getTaskProfiles() const {
+			return lastTaskProfiles;
+		}
+
 		void threadMain();
 
 	protected:
+		void waitForTasks();
+		void releaseQueuedTasks();
+		void executeProfiled(Task* task);
+		void closeTickSlice(std::chrono::steady_clock::time_point now);
+		void reportTickStats() const;
+		void reportTaskProfiles() const;
+
 		std::thread thread;
+		std::atomic<std::thread::id> threadId {std::thread::id()};
 		std::mutex taskLock;
 		std::condition_variable taskSignal;
+		std::atomic<bool> sleeping {false};
 
-		std::list<Task*> taskList;
+		// tasks added with push_front go to their own lane, which is always emptied first
+		LockfreeBatchQueue<Task, &Task::next> priorityTaskQueue;
+		LockfreeBatchQueue<Task, &Task::next> taskQueue;
 		uint64_t dispatcherCycle = 0;
+
+		bool tickAccounting = false;
+		int64_t tickReportInterval = 0;
+		std::vector<std::function<void()>> tickReporters;
+
+		TickCategory tickCategory = TICK_CATEGORY_IDLE;
+		std::chrono::steady_clock::time_point tickCategoryStart;
+		std::chrono::steady_clock::time_point tickSliceStart;
+		std::chrono::steady_clock::time_point tickStatsStart;
+		int64_t tickSliceBusyTime = 0;
+		DispatcherTickStats tickStats;
+		DispatcherTickStats lastTickStats;
+
+		std::atomic<bool> profileTasks {false};
+		int64_t slowTaskThreshold = 0;
+		std::array<int64_t, TICK_CATEGORY_LAST> taskTickTime {};
+		std::unordered_map<const char*, TaskProfile> taskProfiles;
+		std::unordered_map<const char*, TaskProfile> lastTaskProfiles;
 };
 
 extern Dispatcher g_dispatcher;
 
+// Accounts the dispatcher time spent in a scope to the given category
+class DispatcherTickScope
+{
+	public:
+		explicit DispatcherTickScope(TickCategory category) : previous(g_dispatcher.setTickCategory(category)) {}
+		~DispatcherTickScope() {
+			g_dispatcher.setTickCategory(previous);
+		}
+
+		// non-copyable
+		DispatcherTickScope(const DispatcherTickScope&) = delete;
+		DispatcherTickScope& operator=(const DispatcherTickScope&) = delete;
+
+	private:
+		TickCategory previous;
+};
+
 #endif
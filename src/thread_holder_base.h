@@ -48,8 +48,8 @@ class ThreadHolder
 			threadState.store(newState, std::memory_order_relaxed);
 		}
 
-		ThreadState getState() const {
-			return threadState.load(std::memory_order_relaxed);
+		ThreadState getState(std::memory_order order = std::memory_order_relaxed) const {
+			return threadState.load(order);
 		}
 	private:
 		std::atomic<ThreadState> threadState{THREAD_STATE_TERMINATED};
@@ -35,6 +35,11 @@
 extern Game g_game;
 extern MoveEvents* g_moveEvents;
 
+static bool affectsPathing(const ItemType& it)
+{
+	return it.isGroundTile() || it.blockSolid || it.blockPathFind || it.blockProjectile || it.floorChange != 0 || it.isMagicField() || it.isTeleport();
+}
+
 StaticTile real_nullptr_tile(0xFFFF, 0xFFFF, 0xFF);
 Tile& Tile::nullptr_tile = real_nullptr_tile;
 
@@ -382,9 +387,13 @@ void Tile::onAddTileItem(Item* item)
 
 	setTileFlags(item);
 
+	if (item->isCleanable() && !hasFlag(TILESTATE_PROTECTIONZONE)) {
+		g_game.map.markCleanable(this);
+	}
+
 	const Position& cylinderMapPos = getPosition();
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, cylinderMapPos, true);
 
 	//send to client
@@ -420,9 +429,13 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 		}
 	}
 
+	if (newItem->isCleanable() && !hasFlag(TILESTATE_PROTECTIONZONE)) {
+		g_game.map.markCleanable(this);
+	}
+
 	const Position& cylinderMapPos = getPosition();
 
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, cylinderMapPos, true);
 
 	//send to client
@@ -438,7 +451,7 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 	}
 }
 
-void Tile::onRemoveTileItem(const SpectatorHashSet& spectators, const std::vector<int32_t>& oldStackPosVector, Item* item)
+void Tile::onRemoveTileItem(const SpectatorVec& spectators, const std::vector<int32_t>& oldStackPosVector, Item* item)
 {
 	if (item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) {
 		auto it = g_game.browseFields.find(this);
@@ -466,7 +479,7 @@ void Tile::onRemoveTileItem(const SpectatorHashSet& spectators, const std::vecto
 	}
 }
 
-void Tile::onUpdateTile(const SpectatorHashSet& spectators)
+void Tile::onUpdateTile(const SpectatorVec& spectators)
 {
 	const Position& cylinderMapPos = getPosition();
 
@@ -534,24 +547,17 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, uint32_t flags
 			}
 
 			MagicField* field = getFieldItem();
-			if (!field || field->isBlocking()) {
+			if (!field || field->isBlocking() || hasBitSet(FLAG_IGNOREMAGICFIELD, flags)) {
 				return RETURNVALUE_NOERROR;
 			}
 
 			CombatType_t combatType = field->getCombatType();
-
-			//There is 3 options for a monster to enter a magic field
-			//1) Monster is immune
-			if (!monster->isImmune(combatType)) {
-				//1) Monster is "strong" enough to handle the damage
-				//2) Monster is already afflicated by this type of condition
-				if (hasBitSet(FLAG_IGNOREFIELDDAMAGE, flags)) {
-					if (!(monster->canPushItems() || monster->hasCondition(Combat::DamageToConditionType(combatType)))) {
-						return RETURNVALUE_NOTPOSSIBLE;
-					}
-				} else {
+			if (hasBitSet(FLAG_IGNOREFIELDDAMAGE, flags)) {
+				if (!monster->canWalkOnField(combatType)) {
 					return RETURNVALUE_NOTPOSSIBLE;
 				}
+			} else if (!monster->isImmune(combatType)) {
+				return RETURNVALUE_NOTPOSSIBLE;
 			}
 
 			return RETURNVALUE_NOERROR;
@@ -829,7 +835,8 @@ void Tile::addThing(int32_t, Thing* thing)
 {
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game.map.clearSpectatorCache();
+		g_game.map.invalidateSpectatorCache(getPosition());
+		g_game.map.invalidatePathing(getPosition());
 		creature->setParent(this);
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
@@ -1034,7 +1041,8 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 		if (creatures) {
 			auto it = std::find(creatures->begin(), creatures->end(), thing);
 			if (it != creatures->end()) {
-				g_game.map.clearSpectatorCache();
+				g_game.map.invalidateSpectatorCache(getPosition());
+				g_game.map.invalidatePathing(getPosition());
 				creatures->erase(it);
 			}
 		}
@@ -1055,7 +1063,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 		ground->setParent(nullptr);
 		ground = nullptr;
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, getPosition(), true);
 		onRemoveTileItem(spectators, std::vector<int32_t>(spectators.size(), 0), item);
 		return;
@@ -1075,7 +1083,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 
 		std::vector<int32_t> oldStackPosVector;
 
-		SpectatorHashSet spectators;
+		SpectatorVec spectators;
 		g_game.map.getSpectators(spectators, getPosition(), true);
 		for (Creature* spectator : spectators) {
 			if (Player* tmpPlayer = spectator->getPlayer()) {
@@ -1099,7 +1107,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 		} else {
 			std::vector<int32_t> oldStackPosVector;
 
-			SpectatorHashSet spectators;
+			SpectatorVec spectators;
 			g_game.map.getSpectators(spectators, getPosition(), true);
 			for (Creature* spectator : spectators) {
 				if (Player* tmpPlayer = spectator->getPlayer()) {
@@ -1117,7 +1125,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 
 void Tile::removeCreature(Creature* creature)
 {
-	g_game.map.getQTNode(tilePos.x, tilePos.y)->removeCreature(creature);
+	g_game.map.getQTNode(tilePos.x, tilePos.y)->removeCreature(creature, tilePos.z);
 	removeThing(creature, 0);
 }
 
@@ -1342,7 +1350,7 @@ Thing* Tile::getThing(size_t index) const
 
 void Tile::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_t index, cylinderlink_t link /*= LINK_OWNER*/)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), true, true);
 	for (Creature* spectator : spectators) {
 		spectator->getPlayer()->postAddNotification(thing, oldParent, index, LINK_NEAR);
@@ -1397,7 +1405,7 @@ void Tile::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_t
 
 void Tile::postRemoveNotification(Thing* thing, const Cylinder* newParent, int32_t index, cylinderlink_t)
 {
-	SpectatorHashSet spectators;
+	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), true, true);
 
 	if (getThingCount() > 8) {
@@ -1431,7 +1439,8 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game.map.clearSpectatorCache();
+		g_game.map.invalidateSpectatorCache(getPosition());
+		g_game.map.invalidatePathing(getPosition());
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
 	} else {
@@ -1478,6 +1487,10 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 
 void Tile::setTileFlags(const Item* item)
 {
+	if (affectsPathing(Item::items[item->getID()])) {
+		g_game.map.invalidatePathing(getPosition());
+	}
+
 	if (!hasFlag(TILESTATE_FLOORCHANGE)) {
 		const ItemType& it = Item::items[item->getID()];
 		if (it.floorChange != 0) {
@@ -1533,11 +1546,21 @@ void Tile::setTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		setFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		setFlag(TILESTATE_BLOCKPROJECTILE);
+	}
+
+	g_game.map.updateTileBitmaps(*this);
 }
 
 void Tile::resetTileFlags(const Item* item)
 {
 	const ItemType& it = Item::items[item->getID()];
+	if (affectsPathing(it)) {
+		g_game.map.invalidatePathing(getPosition());
+	}
+
 	if (it.floorChange != 0) {
 		resetFlag(TILESTATE_FLOORCHANGE);
 	}
@@ -1594,6 +1617,12 @@ void Tile::resetTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		resetFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE) && !hasProperty(item, CONST_PROP_BLOCKPROJECTILE)) {
+		resetFlag(TILESTATE_BLOCKPROJECTILE);
+	}
+
+	g_game.map.updateTileBitmaps(*this);
 }
 
 bool Tile::isMoveableBlocking() const
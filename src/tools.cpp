@@ -19,11 +19,15 @@
 
 #include "otpch.h"
 
+#include <atomic>
+
 #include "tools.h"
 #include "configmanager.h"
 
 extern ConfigManager g_config;
 
+static std::atomic<int64_t> virtualTime {0};
+
 void printXMLError(const std::string& where, const std::string& fileName, const pugi::xml_parse_result& result)
 {
 	std::cout << '[' << where << "] Failed to load " << fileName << ": " << result.description() << std::endl;
@@ -1195,5 +1199,14 @@ const char* getReturnMessage(ReturnValue value)
 
 int64_t OTSYS_TIME()
 {
+	int64_t time = virtualTime.load(std::memory_order_relaxed);
+	if (time != 0) {
+		return time;
+	}
 	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
+
+void setVirtualTime(int64_t time)
+{
+	virtualTime.store(time, std::memory_order_relaxed);
+}
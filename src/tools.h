@@ -92,5 +92,7 @@ itemAttrTypes stringToItemAttribute(const std::string& str);
 const char* getReturnMessage(ReturnValue value);
 
 int64_t OTSYS_TIME();
+// a replay runs the game on the recorded time, 0 goes back to the system clock
+void setVirtualTime(int64_t time);
 
 #endif
@@ -0,0 +1,270 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "xtea.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XTEA_SSE2
+#include <emmintrin.h>
+
+#if defined(_MSC_VER)
+#define XTEA_AVX2
+#define XTEA_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__)
+#define XTEA_AVX2
+#define XTEA_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+namespace xtea {
+
+namespace {
+
+constexpr uint32_t delta = 0x61C88647;
+
+#ifdef XTEA_AVX2
+bool hasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	// the OS has to save the ymm registers too
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	// we may be called before libgcc initialized the CPU model
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+void encryptBlocks(uint8_t* data, size_t length, const round_keys& k)
+{
+	for (size_t pos = 0; pos < length; pos += 8) {
+		uint32_t v0, v1;
+		memcpy(&v0, data + pos, 4);
+		memcpy(&v1, data + pos + 4, 4);
+
+		for (int32_t i = 0; i < 64; i += 2) {
+			v0 += ((v1 << 4 ^ v1 >> 5) + v1) ^ k[i];
+			v1 += ((v0 << 4 ^ v0 >> 5) + v0) ^ k[i + 1];
+		}
+
+		memcpy(data + pos, &v0, 4);
+		memcpy(data + pos + 4, &v1, 4);
+	}
+}
+
+void decryptBlocks(uint8_t* data, size_t length, const round_keys& k)
+{
+	for (size_t pos = 0; pos < length; pos += 8) {
+		uint32_t v0, v1;
+		memcpy(&v0, data + pos, 4);
+		memcpy(&v1, data + pos + 4, 4);
+
+		for (int32_t i = 64; i > 0; i -= 2) {
+			v1 -= ((v0 << 4 ^ v0 >> 5) + v0) ^ k[i - 1];
+			v0 -= ((v1 << 4 ^ v1 >> 5) + v1) ^ k[i - 2];
+		}
+
+		memcpy(data + pos, &v0, 4);
+		memcpy(data + pos + 4, &v1, 4);
+	}
+}
+
+#ifdef XTEA_SSE2
+// 4 blocks per iteration, the halves of the blocks are split into one register each
+size_t encryptBlocksSSE2(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t pos = 0;
+	for (; pos + 32 <= length; pos += 32) {
+		__m128i a = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i v0 = _mm_unpacklo_epi64(a, b);
+		__m128i v1 = _mm_unpackhi_epi64(a, b);
+
+		for (int32_t i = 0; i < 64; i += 2) {
+			__m128i t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v1, 4), _mm_srli_epi32(v1, 5)), v1);
+			v0 = _mm_add_epi32(v0, _mm_xor_si128(t, _mm_set1_epi32(k[i])));
+			t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v0, 4), _mm_srli_epi32(v0, 5)), v0);
+			v1 = _mm_add_epi32(v1, _mm_xor_si128(t, _mm_set1_epi32(k[i + 1])));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + pos), _mm_shuffle_epi32(_mm_unpacklo_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + pos + 16), _mm_shuffle_epi32(_mm_unpackhi_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	return pos;
+}
+
+size_t decryptBlocksSSE2(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t pos = 0;
+	for (; pos + 32 <= length; pos += 32) {
+		__m128i a = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m128i v0 = _mm_unpacklo_epi64(a, b);
+		__m128i v1 = _mm_unpackhi_epi64(a, b);
+
+		for (int32_t i = 64; i > 0; i -= 2) {
+			__m128i t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v0, 4), _mm_srli_epi32(v0, 5)), v0);
+			v1 = _mm_sub_epi32(v1, _mm_xor_si128(t, _mm_set1_epi32(k[i - 1])));
+			t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v1, 4), _mm_srli_epi32(v1, 5)), v1);
+			v0 = _mm_sub_epi32(v0, _mm_xor_si128(t, _mm_set1_epi32(k[i - 2])));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + pos), _mm_shuffle_epi32(_mm_unpacklo_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + pos + 16), _mm_shuffle_epi32(_mm_unpackhi_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	return pos;
+}
+#endif
+
+#ifdef XTEA_AVX2
+// 8 blocks per iteration, the same split as SSE2 within each 128-bit lane
+XTEA_TARGET_AVX2 size_t encryptBlocksAVX2(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t pos = 0;
+	for (; pos + 64 <= length; pos += 64) {
+		__m256i a = _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i b = _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i v0 = _mm256_unpacklo_epi64(a, b);
+		__m256i v1 = _mm256_unpackhi_epi64(a, b);
+
+		for (int32_t i = 0; i < 64; i += 2) {
+			__m256i t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v1, 4), _mm256_srli_epi32(v1, 5)), v1);
+			v0 = _mm256_add_epi32(v0, _mm256_xor_si256(t, _mm256_set1_epi32(k[i])));
+			t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v0, 4), _mm256_srli_epi32(v0, 5)), v0);
+			v1 = _mm256_add_epi32(v1, _mm256_xor_si256(t, _mm256_set1_epi32(k[i + 1])));
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + pos), _mm256_shuffle_epi32(_mm256_unpacklo_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + pos + 32), _mm256_shuffle_epi32(_mm256_unpackhi_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	return pos;
+}
+
+XTEA_TARGET_AVX2 size_t decryptBlocksAVX2(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t pos = 0;
+	for (; pos + 64 <= length; pos += 64) {
+		__m256i a = _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i b = _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 32)), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i v0 = _mm256_unpacklo_epi64(a, b);
+		__m256i v1 = _mm256_unpackhi_epi64(a, b);
+
+		for (int32_t i = 64; i > 0; i -= 2) {
+			__m256i t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v0, 4), _mm256_srli_epi32(v0, 5)), v0);
+			v1 = _mm256_sub_epi32(v1, _mm256_xor_si256(t, _mm256_set1_epi32(k[i - 1])));
+			t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v1, 4), _mm256_srli_epi32(v1, 5)), v1);
+			v0 = _mm256_sub_epi32(v0, _mm256_xor_si256(t, _mm256_set1_epi32(k[i - 2])));
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + pos), _mm256_shuffle_epi32(_mm256_unpacklo_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + pos + 32), _mm256_shuffle_epi32(_mm256_unpackhi_epi64(v0, v1), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	return pos;
+}
+#endif
+
+}
+
+round_keys expandKey(const key& k)
+{
+	round_keys keys;
+	uint32_t sum = 0;
+	for (int32_t i = 0; i < 64; i += 2) {
+		keys[i] = sum + k[sum & 3];
+		sum -= delta;
+		keys[i + 1] = sum + k[(sum >> 11) & 3];
+	}
+	return keys;
+}
+
+Kernel getKernel()
+{
+#ifdef XTEA_AVX2
+	static const bool avx2 = hasAVX2();
+	if (avx2) {
+		return KERNEL_AVX2;
+	}
+#endif
+#ifdef XTEA_SSE2
+	return KERNEL_SSE2;
+#else
+	return KERNEL_SCALAR;
+#endif
+}
+
+const char* getKernelName(Kernel kernel)
+{
+	switch (kernel) {
+		case KERNEL_AVX2: return "AVX2";
+		case KERNEL_SSE2: return "SSE2";
+		default: return "scalar";
+	}
+}
+
+void encrypt(uint8_t* data, size_t length, const round_keys& k, Kernel kernel)
+{
+	size_t pos = 0;
+#ifdef XTEA_AVX2
+	if (kernel >= KERNEL_AVX2) {
+		pos = encryptBlocksAVX2(data, length, k);
+	}
+#endif
+#ifdef XTEA_SSE2
+	if (kernel >= KERNEL_SSE2) {
+		pos += encryptBlocksSSE2(data + pos, length - pos, k);
+	}
+#endif
+	encryptBlocks(data + pos, length - pos, k);
+}
+
+void decrypt(uint8_t* data, size_t length, const round_keys& k, Kernel kernel)
+{
+	size_t pos = 0;
+#ifdef XTEA_AVX2
+	if (kernel >= KERNEL_AVX2) {
+		pos = decryptBlocksAVX2(data, length, k);
+	}
+#endif
+#ifdef XTEA_SSE2
+	if (kernel >= KERNEL_SSE2) {
+		pos += decryptBlocksSSE2(data + pos, length - pos, k);
+	}
+#endif
+	decryptBlocks(data + pos, length - pos, k);
+}
+
+}
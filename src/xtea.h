@@ -0,0 +1,53 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_XTEA_H_3AA84FC44380D8BB263BC55CD57B50AC
+#define FS_XTEA_H_3AA84FC44380D8BB263BC55CD57B50AC
+
+#include <array>
+
+namespace xtea {
+
+using key = std::array<uint32_t, 4>;
+// sum + key word of both half rounds of every round, in encryption order
+using round_keys = std::array<uint32_t, 64>;
+
+round_keys expandKey(const key& k);
+
+enum Kernel : uint8_t {
+	KERNEL_SCALAR,
+	KERNEL_SSE2, // 4 blocks at once
+	KERNEL_AVX2, // 8 blocks at once
+};
+
+// the widest kernel this CPU runs, detected on first use
+Kernel getKernel();
+const char* getKernelName(Kernel kernel = getKernel());
+
+/**
+  * The blocks are independent, so several are run through the rounds at once
+  * with the widest kernel up to the given one, the rest block by block.
+  * length has to be a multiple of 8, kernel must not be wider than getKernel().
+  */
+void encrypt(uint8_t* data, size_t length, const round_keys& k, Kernel kernel = getKernel());
+void decrypt(uint8_t* data, size_t length, const round_keys& k, Kernel kernel = getKernel());
+
+}
+
+#endif
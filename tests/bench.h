@@ -0,0 +1,39 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_BENCH_H_3F1E0C5A9B2D4E7F8A6C1D0B5E4F3A29
+#define FS_BENCH_H_3F1E0C5A9B2D4E7F8A6C1D0B5E4F3A29
+
+#include <chrono>
+
+// Benchmarks live in the bench suite, which main.cpp disables so it only runs
+// when asked for: tfs_tests --run_test=bench
+#define BENCH_SUITE(name) BOOST_AUTO_TEST_SUITE(bench) BOOST_AUTO_TEST_SUITE(name)
+#define BENCH_SUITE_END() BOOST_AUTO_TEST_SUITE_END() BOOST_AUTO_TEST_SUITE_END()
+
+// Returns the wall time f took in microseconds
+template <typename F>
+int64_t measureTime(F&& f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
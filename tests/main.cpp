@@ -0,0 +1,48 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define BOOST_TEST_MODULE tfs_tests
+#include "otpch.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include "databasetasks.h"
+#include "game.h"
+#include "configmanager.h"
+#include "monsters.h"
+#include "vocation.h"
+#include "rsa.h"
+#include "scheduler.h"
+#include "replay.h"
+
+// the globals otserv.cpp defines for the server
+DatabaseTasks g_databaseTasks;
+Dispatcher g_dispatcher;
+Scheduler g_scheduler;
+Replay g_replay;
+
+Game g_game;
+ConfigManager g_config;
+Monsters g_monsters;
+Vocations g_vocations;
+RSA g_RSA;
+
+// a test unit takes a single enabled/disabled decorator, so the bench suite gets it here only
+BOOST_AUTO_TEST_SUITE(bench, *boost::unit_test::disabled())
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+
+#include <queue>
+
+extern Game g_game;
+
+namespace {
+
+const Position FIELD_FROM(200, 300, 7);
+const Position FIELD_TO(239, 339, 7);
+const Position MAZE_FROM(250, 300, 7);
+const Position MAZE_TO(299, 349, 7);
+// a walled ring in an open box, nothing outside of it reaches its centre
+const Position POCKET_FROM(250, 360, 7);
+const Position POCKET_TO(299, 399, 7);
+const Position POCKET_CENTRE(275, 380, 7);
+
+constexpr int32_t SEARCH_DIST = 8;
+
+void createAreas()
+{
+	static bool created = false;
+	if (!created) {
+		created = true;
+		testworld::createArea(FIELD_FROM, FIELD_TO);
+
+		std::mt19937 generator(0xA57A);
+		std::bernoulli_distribution wall(0.3);
+		testworld::createArea(MAZE_FROM, MAZE_TO, [&](const Position&) { return wall(generator); });
+
+		testworld::createArea(POCKET_FROM, POCKET_TO, [](const Position& pos) {
+			return std::max(Position::getDistanceX(pos, POCKET_CENTRE), Position::getDistanceY(pos, POCKET_CENTRE)) == 3;
+		});
+	}
+}
+
+bool isWalkable(const Position& pos)
+{
+	const Tile* tile = g_game.map.getTile(pos);
+	return tile && !tile->hasFlag(TILESTATE_BLOCKSOLID);
+}
+
+int32_t getStepCost(const Position& fromPos, const Position& toPos)
+{
+	return fromPos.x != toPos.x && fromPos.y != toPos.y ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST;
+}
+
+// the cheapest walk within the search box by Dijkstra over every neighbour, -1 if there is none
+int32_t getCheapestWalk(const Position& startPos, const Position& targetPos, int32_t maxSearchDist)
+{
+	constexpr int32_t size = 2 * SEARCH_DIST + 1;
+	std::vector<int32_t> costs(size * size, std::numeric_limits<int32_t>::max());
+	auto getIndex = [&](const Position& pos) {
+		return (pos.y - startPos.y + maxSearchDist) * size + (pos.x - startPos.x + maxSearchDist);
+	};
+
+	typedef std::pair<int32_t, Position> Entry;
+	auto isCostlier = [](const Entry& a, const Entry& b) { return a.first > b.first; };
+	std::priority_queue<Entry, std::vector<Entry>, decltype(isCostlier)> queue(isCostlier);
+	costs[getIndex(startPos)] = 0;
+	queue.emplace(0, startPos);
+	while (!queue.empty()) {
+		Entry entry = queue.top();
+		queue.pop();
+		const Position& pos = entry.second;
+		if (pos == targetPos) {
+			return entry.first;
+		}
+
+		if (entry.first != costs[getIndex(pos)]) {
+			continue;
+		}
+
+		for (int32_t dy = -1; dy <= 1; ++dy) {
+			for (int32_t dx = -1; dx <= 1; ++dx) {
+				Position nextPos(pos.x + dx, pos.y + dy, pos.z);
+				if (nextPos == pos || Position::getDistanceX(startPos, nextPos) > maxSearchDist || Position::getDistanceY(startPos, nextPos) > maxSearchDist || !isWalkable(nextPos)) {
+					continue;
+				}
+
+				int32_t cost = entry.first + getStepCost(pos, nextPos);
+				if (cost < costs[getIndex(nextPos)]) {
+					costs[getIndex(nextPos)] = cost;
+					queue.emplace(cost, nextPos);
+				}
+			}
+		}
+	}
+	return -1;
+}
+
+FindPathParams getWalkParams(int32_t maxSearchDist)
+{
+	FindPathParams fpp;
+	fpp.fullPathSearch = true;
+	fpp.clearSight = false;
+	fpp.maxSearchDist = maxSearchDist;
+	fpp.minTargetDist = 0;
+	fpp.maxTargetDist = 0;
+	return fpp;
+}
+
+// the cost of walking dirList from startPos, -1 if it runs into a wall or does not end on targetPos
+int32_t getWalkCost(Position pos, const std::forward_list<Direction>& dirList, const Position& targetPos)
+{
+	int32_t cost = 0;
+	for (Direction dir : dirList) {
+		Position nextPos = getNextPosition(dir, pos);
+		if (!isWalkable(nextPos)) {
+			return -1;
+		}
+
+		cost += getStepCost(pos, nextPos);
+		pos = nextPos;
+	}
+	return pos == targetPos ? cost : -1;
+}
+
+// random start and target pairs in the box, both free and at most maxDist apart
+std::vector<std::pair<Position, Position>> getWalkPairs(const Position& fromPos, const Position& toPos, int32_t maxDist, size_t count, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_int_distribution<int32_t> offset(-maxDist, maxDist);
+
+	std::vector<std::pair<Position, Position>> pairs;
+	while (pairs.size() < count) {
+		Position startPos = testworld::getFreePosition(Position(fromPos.x + maxDist, fromPos.y + maxDist, fromPos.z), Position(toPos.x - maxDist, toPos.y - maxDist, toPos.z), generator);
+		Position targetPos(startPos.x + offset(generator), startPos.y + offset(generator), startPos.z);
+		if (targetPos != startPos && isWalkable(targetPos)) {
+			pairs.emplace_back(startPos, targetPos);
+		}
+	}
+	return pairs;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(astar)
+
+BOOST_AUTO_TEST_CASE(paths_are_the_cheapest_walks)
+{
+	createAreas();
+
+	std::mt19937 generator(0xA57A);
+	Monster* monster = testworld::placeMonster(testworld::getFreePosition(MAZE_FROM, MAZE_TO, generator));
+	const FindPathParams fpp = getWalkParams(SEARCH_DIST);
+
+	size_t reachable = 0;
+	for (const auto& pair : getWalkPairs(MAZE_FROM, MAZE_TO, SEARCH_DIST, 2000, 0xA57A)) {
+		BOOST_REQUIRE_EQUAL(g_game.internalTeleport(monster, pair.first), RETURNVALUE_NOERROR);
+
+		std::forward_list<Direction> dirList;
+		bool found = g_game.map.getPathMatching(*monster, dirList, FrozenPathingConditionCall(pair.second), fpp);
+		int32_t cheapestCost = getCheapestWalk(pair.first, pair.second, SEARCH_DIST);
+		BOOST_TEST_CONTEXT("path from " << pair.first << " to " << pair.second) {
+			BOOST_REQUIRE_EQUAL(found, cheapestCost != -1);
+			if (found) {
+				BOOST_REQUIRE_EQUAL(getWalkCost(pair.first, dirList, pair.second), cheapestCost);
+				++reachable;
+			}
+		}
+	}
+	BOOST_CHECK_GT(reachable, 0u);
+
+	g_game.removeCreature(monster);
+}
+
+BOOST_AUTO_TEST_CASE(open_field_paths_walk_straight)
+{
+	createAreas();
+
+	std::mt19937 generator(0xF1E1D);
+	Monster* monster = testworld::placeMonster(testworld::getFreePosition(FIELD_FROM, FIELD_TO, generator));
+	const FindPathParams fpp = getWalkParams(SEARCH_DIST);
+
+	// a diagonal step costs more than two straight ones, so the path takes none
+	for (const auto& pair : getWalkPairs(FIELD_FROM, FIELD_TO, SEARCH_DIST, 200, 0xF1E1D)) {
+		BOOST_REQUIRE_EQUAL(g_game.internalTeleport(monster, pair.first), RETURNVALUE_NOERROR);
+
+		std::forward_list<Direction> dirList;
+		BOOST_TEST_CONTEXT("path from " << pair.first << " to " << pair.second) {
+			BOOST_REQUIRE(g_game.map.getPathMatching(*monster, dirList, FrozenPathingConditionCall(pair.second), fpp));
+			BOOST_CHECK_EQUAL(std::distance(dirList.begin(), dirList.end()), Position::getDistanceX(pair.first, pair.second) + Position::getDistanceY(pair.first, pair.second));
+		}
+	}
+
+	g_game.removeCreature(monster);
+}
+
+BOOST_AUTO_TEST_CASE(walled_in_targets_are_not_found)
+{
+	createAreas();
+
+	// the search box fits the node limit, so the search ends by running out of tiles
+	Monster* monster = testworld::placeMonster(Position(POCKET_CENTRE.x - 6, POCKET_CENTRE.y + 1, POCKET_CENTRE.z));
+
+	std::forward_list<Direction> dirList;
+	BOOST_CHECK(!g_game.map.getPathMatching(*monster, dirList, FrozenPathingConditionCall(POCKET_CENTRE), getWalkParams(SEARCH_DIST)));
+	BOOST_CHECK(dirList.empty());
+
+	g_game.removeCreature(monster);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(astar)
+
+BOOST_AUTO_TEST_CASE(searches)
+{
+	createAreas();
+
+	std::mt19937 generator(0xA57A);
+	Monster* monster = testworld::placeMonster(testworld::getFreePosition(FIELD_FROM, FIELD_TO, generator));
+
+	auto measureSearches = [&](const char* name, const std::vector<std::pair<Position, Position>>& pairs, const FindPathParams& fpp) {
+		size_t searches = 0;
+		size_t found = 0;
+		int64_t time = 0;
+		for (size_t round = 0; round < 10; ++round) {
+			for (const auto& pair : pairs) {
+				if (g_game.internalTeleport(monster, pair.first) != RETURNVALUE_NOERROR) {
+					continue;
+				}
+
+				++searches;
+				time += measureTime([&]() {
+					std::forward_list<Direction> dirList;
+					found += g_game.map.getPathMatching(*monster, dirList, FrozenPathingConditionCall(pair.second), fpp);
+				});
+			}
+		}
+		std::cout << "> " << name << ": " << time * 1000 / std::max<size_t>(1, searches) << " ns per search, " << found << " of " << searches << " found." << std::endl;
+	};
+
+	measureSearches("open field", getWalkPairs(FIELD_FROM, FIELD_TO, 8, 1000, 1), getWalkParams(12));
+	measureSearches("maze", getWalkPairs(MAZE_FROM, MAZE_TO, 8, 1000, 2), getWalkParams(12));
+
+	// every search walks the whole box around the pocket before it gives up
+	std::vector<std::pair<Position, Position>> pocketPairs;
+	for (int32_t offset = -7; offset <= 7; ++offset) {
+		pocketPairs.emplace_back(Position(POCKET_CENTRE.x + offset, POCKET_CENTRE.y - 6, POCKET_CENTRE.z), POCKET_CENTRE);
+	}
+	measureSearches("unreachable", pocketPairs, getWalkParams(SEARCH_DIST));
+
+	g_game.removeCreature(monster);
+}
+
+BENCH_SUITE_END()
@@ -0,0 +1,158 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "creaturethink.h"
+#include "testworld.h"
+#include "bench.h"
+
+extern Game g_game;
+
+namespace {
+
+const Position AREA_FROM(100, 100, 7);
+const int32_t GROUP_COUNT = 6; // groups per row and column
+const int32_t GROUP_SIZE = 10; // tiles per side, a follower always sees its target
+const int32_t GROUP_FOLLOWERS = 20;
+
+// summons chasing the target of their group through a walled area, summons
+// always search their own path instead of taking a flow field step
+const std::list<Creature*>& getFollowers()
+{
+	static std::list<Creature*> followers;
+	if (!followers.empty()) {
+		return followers;
+	}
+
+	std::mt19937 generator(0xC0FFEE);
+	std::bernoulli_distribution wall(0.15);
+	const Position areaTo(AREA_FROM.x + GROUP_COUNT * GROUP_SIZE * 2, AREA_FROM.y + GROUP_COUNT * GROUP_SIZE * 2, AREA_FROM.z);
+	testworld::createArea(AREA_FROM, areaTo, [&](const Position&) { return wall(generator); });
+
+	std::vector<std::pair<Monster*, std::vector<Monster*>>> groups;
+	for (int32_t y = 0; y < GROUP_COUNT; ++y) {
+		for (int32_t x = 0; x < GROUP_COUNT; ++x) {
+			const Position groupFrom(AREA_FROM.x + x * GROUP_SIZE * 2 + GROUP_SIZE / 2, AREA_FROM.y + y * GROUP_SIZE * 2 + GROUP_SIZE / 2, AREA_FROM.z);
+			const Position groupTo(groupFrom.x + GROUP_SIZE - 1, groupFrom.y + GROUP_SIZE - 1, groupFrom.z);
+
+			Monster* master = testworld::placeMonster(testworld::getFreePosition(groupFrom, groupTo, generator));
+			groups.emplace_back(testworld::placeMonster(testworld::getFreePosition(groupFrom, groupTo, generator)), std::vector<Monster*>());
+			for (int32_t i = 0; i < GROUP_FOLLOWERS; ++i) {
+				groups.back().second.push_back(testworld::placeMonster(testworld::getFreePosition(groupFrom, groupTo, generator), master));
+			}
+		}
+	}
+
+	// only once everyone stands, a later arrival would not change their paths anyway
+	for (const auto& group : groups) {
+		for (Monster* follower : group.second) {
+			follower->setFollowCreature(group.first);
+			followers.push_back(follower);
+		}
+	}
+	return followers;
+}
+
+bool searchFollowPath(const Creature& follower, std::forward_list<Direction>& dirList)
+{
+	FindPathParams fpp;
+	follower.willSearchFollowPath(EVENT_CREATURE_THINK_INTERVAL, fpp);
+	return g_game.map.getPathMatching(follower, dirList, FrozenPathingConditionCall(follower.getFollowCreature()->getPosition()), fpp);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(creature_think)
+
+BOOST_AUTO_TEST_CASE(prefetched_paths_match_the_serial_search)
+{
+	const std::list<Creature*>& followers = getFollowers();
+
+	for (int32_t threadCount : {1, 2, 4, 8}) {
+		CreatureThinkPool pool;
+		pool.start(threadCount);
+		pool.prepareFollowPaths(followers, EVENT_CREATURE_THINK_INTERVAL);
+
+		size_t prefetched = 0;
+		for (Creature* follower : followers) {
+			FindPathParams fpp;
+			BOOST_REQUIRE(follower->willSearchFollowPath(EVENT_CREATURE_THINK_INTERVAL, fpp));
+
+			std::forward_list<Direction> prefetchedDirList;
+			bool prefetchedFound;
+			if (!pool.getFollowPath(*follower, follower->getFollowCreature()->getPosition(), fpp, prefetchedDirList, prefetchedFound)) {
+				continue;
+			}
+			++prefetched;
+
+			std::forward_list<Direction> dirList;
+			bool found = searchFollowPath(*follower, dirList);
+			BOOST_TEST_CONTEXT(threadCount << " threads, follower at " << follower->getPosition()) {
+				BOOST_CHECK_EQUAL(prefetchedFound, found);
+				BOOST_CHECK(prefetchedDirList == dirList);
+			}
+		}
+		pool.clearFollowPaths();
+
+		BOOST_CHECK_EQUAL(prefetched, followers.size());
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(creature_think)
+
+BOOST_AUTO_TEST_CASE(thread_scaling)
+{
+	const std::list<Creature*>& followers = getFollowers();
+	const int32_t rounds = 20;
+
+	int64_t serialTime = measureTime([&]() {
+		for (int32_t i = 0; i < rounds; ++i) {
+			for (Creature* follower : followers) {
+				std::forward_list<Direction> dirList;
+				searchFollowPath(*follower, dirList);
+			}
+		}
+	});
+	std::cout << "> " << followers.size() << " followers searched serially: " << serialTime / rounds << " us per round." << std::endl;
+
+	const int32_t hardwareThreads = std::max<int32_t>(1, std::thread::hardware_concurrency());
+	for (int32_t threadCount = 1; threadCount < hardwareThreads * 2; threadCount *= 2) {
+		CreatureThinkPool pool;
+		pool.start(threadCount);
+
+		int64_t time = measureTime([&]() {
+			for (int32_t i = 0; i < rounds; ++i) {
+				pool.prepareFollowPaths(followers, EVENT_CREATURE_THINK_INTERVAL);
+				pool.clearFollowPaths();
+			}
+		});
+
+		// the dispatcher searches alongside the workers
+		std::cout << "> " << followers.size() << " followers on " << threadCount + 1 << " threads: " << time / rounds
+		          << " us per round, " << std::fixed << std::setprecision(2) << static_cast<double>(serialTime) / std::max<int64_t>(1, time)
+		          << "x the serial search, " << hardwareThreads << " hardware threads." << std::endl;
+	}
+}
+
+BENCH_SUITE_END()
@@ -0,0 +1,206 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "tasks.h"
+#include "bench.h"
+
+#include <future>
+#include <list>
+
+namespace {
+
+struct QueueNode {
+	QueueNode* next = nullptr;
+	uint32_t producer = 0;
+	uint32_t sequence = 0;
+};
+
+using NodeQueue = LockfreeBatchQueue<QueueNode, &QueueNode::next>;
+
+// what the dispatcher used before: a list guarded by a mutex
+class LockedNodeQueue
+{
+	public:
+		void push(QueueNode* node) {
+			std::lock_guard<std::mutex> lockGuard(lock);
+			nodes.push_back(node);
+		}
+
+		QueueNode* pop() {
+			std::lock_guard<std::mutex> lockGuard(lock);
+			if (nodes.empty()) {
+				return nullptr;
+			}
+			QueueNode* node = nodes.front();
+			nodes.pop_front();
+			return node;
+		}
+
+	private:
+		std::mutex lock;
+		std::list<QueueNode*> nodes;
+};
+
+const uint32_t PRODUCERS = 4;
+
+// pushes count nodes from each producer thread while the calling thread
+// consumes them, returns the number of nodes consumed out of order
+template <typename Push, typename Consume>
+uint32_t runProducers(std::vector<QueueNode>& nodes, uint32_t count, Push push, Consume consume)
+{
+	std::vector<std::thread> producers;
+	for (uint32_t producer = 0; producer < PRODUCERS; ++producer) {
+		producers.emplace_back([&nodes, count, producer, push]() {
+			for (uint32_t i = 0; i < count; ++i) {
+				QueueNode& node = nodes[producer * count + i];
+				node.producer = producer;
+				node.sequence = i;
+				push(&node);
+			}
+		});
+	}
+
+	std::vector<uint32_t> nextSequence(PRODUCERS);
+	uint32_t outOfOrder = 0;
+	uint32_t consumed = 0;
+	while (consumed < PRODUCERS * count) {
+		consume([&](QueueNode* node) {
+			if (node->sequence != nextSequence[node->producer]) {
+				++outOfOrder;
+			}
+			nextSequence[node->producer] = node->sequence + 1;
+			++consumed;
+		});
+	}
+
+	for (std::thread& producer : producers) {
+		producer.join();
+	}
+	return outOfOrder;
+}
+
+template <typename Visit>
+void drainQueue(NodeQueue& queue, Visit visit)
+{
+	QueueNode* node = queue.drain();
+	while (node) {
+		QueueNode* next = node->next;
+		visit(node);
+		node = next;
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(dispatcher)
+
+BOOST_AUTO_TEST_CASE(batch_queue_keeps_the_order_of_each_producer)
+{
+	const uint32_t count = 50000;
+	std::vector<QueueNode> nodes(PRODUCERS * count);
+
+	NodeQueue queue;
+	uint32_t outOfOrder = runProducers(nodes, count,
+		[&queue](QueueNode* node) { queue.push(node); },
+		[&queue](const std::function<void(QueueNode*)>& visit) { drainQueue(queue, visit); });
+
+	BOOST_CHECK_EQUAL(outOfOrder, 0u);
+	BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(batch_queue_drains_chains_in_push_order)
+{
+	std::vector<QueueNode> nodes(4);
+	for (uint32_t i = 0; i < nodes.size(); ++i) {
+		nodes[i].sequence = i;
+	}
+
+	// pushChain takes the chain linked backwards, like Dispatcher::addTasks builds it
+	NodeQueue queue;
+	queue.push(&nodes[0]);
+	nodes[3].next = &nodes[2];
+	nodes[2].next = &nodes[1];
+	queue.pushChain(&nodes[3], &nodes[1]);
+
+	std::vector<uint32_t> drained;
+	drainQueue(queue, [&drained](QueueNode* node) { drained.push_back(node->sequence); });
+	BOOST_CHECK((drained == std::vector<uint32_t> {0, 1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(priority_tasks_run_first_in_the_order_they_were_added)
+{
+	Dispatcher dispatcher;
+	dispatcher.start();
+
+	// keep the dispatcher busy until everything is queued
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	dispatcher.addTask(createTask([released]() { released.wait(); }));
+
+	std::vector<int> executed;
+	for (int i = 1; i <= 3; ++i) {
+		dispatcher.addTask(createTask([&executed, i]() { executed.push_back(i); }));
+	}
+	for (int i = -1; i >= -3; --i) {
+		dispatcher.addTask(createTask([&executed, i]() { executed.push_back(i); }), true);
+	}
+
+	release.set_value();
+	dispatcher.shutdown();
+	dispatcher.join();
+
+	BOOST_CHECK((executed == std::vector<int> {-1, -2, -3, 1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(dispatcher)
+
+BOOST_AUTO_TEST_CASE(producer_contention)
+{
+	const uint32_t count = 200000;
+	std::vector<QueueNode> nodes(PRODUCERS * count);
+
+	NodeQueue queue;
+	int64_t lockfreeTime = measureTime([&]() {
+		runProducers(nodes, count,
+			[&queue](QueueNode* node) { queue.push(node); },
+			[&queue](const std::function<void(QueueNode*)>& visit) { drainQueue(queue, visit); });
+	});
+
+	LockedNodeQueue lockedQueue;
+	int64_t lockedTime = measureTime([&]() {
+		runProducers(nodes, count,
+			[&lockedQueue](QueueNode* node) { lockedQueue.push(node); },
+			[&lockedQueue](const std::function<void(QueueNode*)>& visit) {
+				while (QueueNode* node = lockedQueue.pop()) {
+					visit(node);
+				}
+			});
+	});
+
+	std::cout << "> " << PRODUCERS << " producers pushing " << count << " tasks each: lock-free batch queue " << lockfreeTime / 1000
+	          << " ms, mutex and list " << lockedTime / 1000 << " ms." << std::endl;
+}
+
+BENCH_SUITE_END()
@@ -0,0 +1,275 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+#include "flowfield.h"
+
+#include <queue>
+
+extern Game g_game;
+
+namespace {
+
+const Position AREA_FROM(400, 300, 7);
+const Position AREA_TO(463, 363, 7);
+
+void createWalledArea()
+{
+	static bool created = false;
+	if (!created) {
+		created = true;
+		std::mt19937 generator(0xF10);
+		std::bernoulli_distribution wall(0.15);
+		testworld::createArea(AREA_FROM, AREA_TO, [&](const Position&) { return wall(generator); });
+	}
+}
+
+// whether a path may lead over pos, read from the tile itself
+bool isPathFree(const Position& pos)
+{
+	const Tile* tile = g_game.map.getTile(pos);
+	return tile && tile->getGround() && !tile->hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT);
+}
+
+// the cheapest walks from every tile within the field radius to targetPos, -1 where there is none
+std::map<Position, int32_t> getCheapestWalks(const Position& targetPos)
+{
+	std::map<Position, int32_t> costs;
+	typedef std::pair<int32_t, Position> Entry;
+	auto isCostlier = [](const Entry& a, const Entry& b) { return a.first > b.first; };
+	std::priority_queue<Entry, std::vector<Entry>, decltype(isCostlier)> queue(isCostlier);
+	costs[targetPos] = 0;
+	queue.emplace(0, targetPos);
+	while (!queue.empty()) {
+		Entry entry = queue.top();
+		queue.pop();
+		const Position& pos = entry.second;
+		if (entry.first != costs[pos]) {
+			continue;
+		}
+
+		for (int32_t dy = -1; dy <= 1; ++dy) {
+			for (int32_t dx = -1; dx <= 1; ++dx) {
+				Position nextPos(pos.x + dx, pos.y + dy, pos.z);
+				if (nextPos == pos || Position::getDistanceX(targetPos, nextPos) > FLOW_FIELD_RADIUS || Position::getDistanceY(targetPos, nextPos) > FLOW_FIELD_RADIUS || !isPathFree(nextPos)) {
+					continue;
+				}
+
+				int32_t cost = entry.first + (dx != 0 && dy != 0 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+				auto it = costs.find(nextPos);
+				if (it == costs.end() || cost < it->second) {
+					costs[nextPos] = cost;
+					queue.emplace(cost, nextPos);
+				}
+			}
+		}
+	}
+	return costs;
+}
+
+void checkFlowField(const Position& targetPos)
+{
+	const std::map<Position, int32_t> costs = getCheapestWalks(targetPos);
+	const FlowField& field = g_game.map.getFlowField(targetPos);
+	for (int32_t dy = -FLOW_FIELD_RADIUS; dy <= FLOW_FIELD_RADIUS; ++dy) {
+		for (int32_t dx = -FLOW_FIELD_RADIUS; dx <= FLOW_FIELD_RADIUS; ++dx) {
+			Position pos(targetPos.x + dx, targetPos.y + dy, targetPos.z);
+			auto it = costs.find(pos);
+			BOOST_TEST_CONTEXT("cost of " << pos << " to " << targetPos) {
+				BOOST_CHECK_EQUAL(field.getCost(pos), it != costs.end() ? it->second : -1);
+			}
+		}
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(flow_field)
+
+BOOST_AUTO_TEST_CASE(costs_are_the_cheapest_walks)
+{
+	createWalledArea();
+
+	std::mt19937 generator(0xF10F10);
+	for (size_t i = 0; i < 20; ++i) {
+		checkFlowField(testworld::getFreePosition(AREA_FROM, AREA_TO, generator));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(fields_follow_walls_added_and_removed)
+{
+	createWalledArea();
+
+	std::mt19937 generator(0xF10F11);
+	const Position targetPos = testworld::getFreePosition(Position(AREA_FROM.x + 4, AREA_FROM.y + 4, AREA_FROM.z), Position(AREA_TO.x - 4, AREA_TO.y - 4, AREA_TO.z), generator);
+	checkFlowField(targetPos);
+
+	// next to the target, so the field is sure to change
+	Tile* tile = g_game.map.getTile(testworld::getFreePosition(Position(targetPos.x - 2, targetPos.y - 2, targetPos.z), Position(targetPos.x + 2, targetPos.y + 2, targetPos.z), generator));
+	if (tile->getPosition() == targetPos) {
+		tile = g_game.map.getTile(targetPos.x + 3, targetPos.y, targetPos.z);
+	}
+
+	Item* wall = Item::CreateItem(testworld::ITEM_WALL);
+	BOOST_REQUIRE_EQUAL(g_game.internalAddItem(tile, wall, INDEX_WHEREEVER, FLAG_NOLIMIT), RETURNVALUE_NOERROR);
+	checkFlowField(targetPos);
+	BOOST_CHECK_EQUAL(g_game.map.getFlowField(targetPos).getCost(tile->getPosition()), -1);
+
+	BOOST_REQUIRE_EQUAL(g_game.internalRemoveItem(wall), RETURNVALUE_NOERROR);
+	checkFlowField(targetPos);
+}
+
+BOOST_AUTO_TEST_CASE(downhill_steps_reach_the_target)
+{
+	createWalledArea();
+
+	std::mt19937 generator(0xF10F12);
+	Monster* target = testworld::placeMonster(testworld::getFreePosition(AREA_FROM, AREA_TO, generator));
+	Monster* chaser = testworld::placeMonster(testworld::getFreePosition(AREA_FROM, AREA_TO, generator));
+
+	size_t chases = 0;
+	for (size_t i = 0; i < 200; ++i) {
+		// following needs the target in view
+		const Position& targetPos = target->getPosition();
+		Position startPos = testworld::getFreePosition(Position(targetPos.x - Map::maxClientViewportX, targetPos.y - Map::maxClientViewportY, targetPos.z), Position(targetPos.x + Map::maxClientViewportX, targetPos.y + Map::maxClientViewportY, targetPos.z), generator);
+		if (g_game.internalTeleport(chaser, startPos) != RETURNVALUE_NOERROR) {
+			continue;
+		}
+
+		int32_t cost = g_game.map.getFlowField(targetPos).getCost(startPos);
+		if (cost < 0 || Position::areInRange<1, 1>(startPos, targetPos)) {
+			continue;
+		}
+
+		BOOST_REQUIRE(chaser->setFollowCreature(target));
+		++chases;
+		BOOST_TEST_CONTEXT("chase from " << startPos << " to " << targetPos) {
+			// a detour out of view makes the chaser give up, as it would in game
+			while (!Position::areInRange<1, 1>(chaser->getPosition(), targetPos) && chaser->getFollowCreature() == target) {
+				Direction direction;
+				BOOST_REQUIRE(chaser->getFlowFieldStep(direction));
+				BOOST_REQUIRE_EQUAL(g_game.internalMoveCreature(chaser, direction, FLAG_IGNOREFIELDDAMAGE), RETURNVALUE_NOERROR);
+
+				int32_t nextCost = g_game.map.getFlowField(targetPos).getCost(chaser->getPosition());
+				BOOST_REQUIRE_LT(nextCost, cost);
+				cost = nextCost;
+			}
+		}
+
+		// somewhere else for the next chase
+		g_game.internalTeleport(target, testworld::getFreePosition(AREA_FROM, AREA_TO, generator));
+	}
+	BOOST_CHECK_GT(chases, 0u);
+
+	g_game.removeCreature(chaser);
+	g_game.removeCreature(target);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(flow_field)
+
+BOOST_AUTO_TEST_CASE(mob_chase)
+{
+	createWalledArea();
+
+	const Position centrePos((AREA_FROM.x + AREA_TO.x) / 2, (AREA_FROM.y + AREA_TO.y) / 2, AREA_FROM.z);
+	for (size_t chaserCount : {10, 30, 60}) {
+		std::mt19937 generator(0x30B);
+		Monster* target = testworld::placeMonster(testworld::getFreePosition(Position(centrePos.x - 1, centrePos.y - 1, centrePos.z), Position(centrePos.x + 1, centrePos.y + 1, centrePos.z), generator));
+
+		// the chasers start in view of the target, as following needs that
+		const Position targetStartPos = target->getPosition();
+		const Position mobFrom(targetStartPos.x - Map::maxClientViewportX, targetStartPos.y - Map::maxClientViewportY, targetStartPos.z);
+		const Position mobTo(targetStartPos.x + Map::maxClientViewportX, targetStartPos.y + Map::maxClientViewportY, targetStartPos.z);
+		std::vector<Monster*> chasers;
+		std::vector<Position> startPositions;
+		for (size_t i = 0; i < chaserCount; ++i) {
+			Monster* chaser = testworld::placeMonster(testworld::getFreePosition(mobFrom, mobTo, generator));
+			BOOST_REQUIRE(chaser->setFollowCreature(target));
+			chasers.push_back(chaser);
+			startPositions.push_back(chaser->getPosition());
+		}
+
+		// every tick the target steps away and every chaser that is not next to it picks a step towards it
+		for (bool useFlowField : {false, true}) {
+			g_game.internalTeleport(target, targetStartPos);
+			for (size_t i = 0; i < chasers.size(); ++i) {
+				g_game.internalTeleport(chasers[i], startPositions[i]);
+			}
+
+			FindPathParams fpp;
+			fpp.fullPathSearch = true;
+			fpp.maxSearchDist = 12;
+			fpp.minTargetDist = 1;
+			fpp.maxTargetDist = 1;
+
+			std::mt19937 stepGenerator(0x30B);
+			std::uniform_int_distribution<int32_t> targetStep(DIRECTION_NORTH, DIRECTION_WEST);
+			size_t flowSteps = 0;
+			size_t searches = 0;
+			int64_t time = 0;
+			for (size_t tick = 0; tick < 200; ++tick) {
+				Direction direction = static_cast<Direction>(targetStep(stepGenerator));
+				if (Position::areInRange<12, 12>(getNextPosition(direction, target->getPosition()), centrePos)) {
+					g_game.internalMoveCreature(target, direction, FLAG_IGNOREFIELDDAMAGE);
+				}
+
+				std::vector<std::pair<Monster*, Direction>> steps;
+				time += measureTime([&]() {
+					for (Monster* chaser : chasers) {
+						if (Position::areInRange<1, 1>(chaser->getPosition(), target->getPosition())) {
+							continue;
+						}
+
+						if (useFlowField && chaser->getFlowFieldStep(direction)) {
+							steps.emplace_back(chaser, direction);
+							++flowSteps;
+							continue;
+						}
+
+						++searches;
+						std::forward_list<Direction> dirList;
+						if (chaser->getPathTo(target->getPosition(), dirList, fpp) && !dirList.empty()) {
+							steps.emplace_back(chaser, dirList.front());
+						}
+					}
+				});
+
+				for (const auto& step : steps) {
+					g_game.internalMoveCreature(step.first, step.second, FLAG_IGNOREFIELDDAMAGE);
+				}
+			}
+			std::cout << "> " << chaserCount << " chasers " << (useFlowField ? "on the flow field" : "searching paths") << ": "
+			          << time / 200 << " us per tick, " << flowSteps << " downhill steps, " << searches << " A* searches." << std::endl;
+		}
+
+		for (Monster* chaser : chasers) {
+			g_game.removeCreature(chaser);
+		}
+		g_game.removeCreature(target);
+	}
+}
+
+BENCH_SUITE_END()
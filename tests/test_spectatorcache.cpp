@@ -0,0 +1,145 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+
+extern Game g_game;
+
+namespace {
+
+// a depot: a hall crowded with creatures, most of them standing still
+const Position DEPOT_FROM(300, 100, 7);
+const Position DEPOT_TO(339, 129, 7);
+const size_t DEPOT_CREATURES = 150;
+
+std::vector<Creature*>& getDepotCreatures()
+{
+	static std::vector<Creature*> creatures;
+	if (creatures.empty()) {
+		std::mt19937 generator(0xDE9075);
+		testworld::createArea(DEPOT_FROM, DEPOT_TO);
+		for (size_t i = 0; i < DEPOT_CREATURES; ++i) {
+			creatures.push_back(testworld::placeMonster(testworld::getFreePosition(DEPOT_FROM, DEPOT_TO, generator)));
+		}
+	}
+	return creatures;
+}
+
+// what a scan of the whole depot finds around centerPos, the depot is on a single floor
+std::vector<Creature*> findSpectators(const std::vector<Creature*>& creatures, const Position& centerPos)
+{
+	std::vector<Creature*> spectators;
+	for (Creature* creature : creatures) {
+		const Position& pos = creature->getPosition();
+		if (Position::getDistanceX(pos, centerPos) <= Map::maxViewportX && Position::getDistanceY(pos, centerPos) <= Map::maxViewportY) {
+			spectators.push_back(creature);
+		}
+	}
+	std::sort(spectators.begin(), spectators.end());
+	return spectators;
+}
+
+std::vector<Creature*> getSpectators(const Position& centerPos)
+{
+	SpectatorVec spectators;
+	g_game.map.getSpectators(spectators, centerPos, true);
+	std::vector<Creature*> result(spectators.begin(), spectators.end());
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+void moveRandomly(const std::vector<Creature*>& creatures, size_t count, std::mt19937& generator)
+{
+	std::uniform_int_distribution<size_t> creature(0, creatures.size() - 1);
+	std::uniform_int_distribution<int32_t> direction(DIRECTION_NORTH, DIRECTION_WEST);
+	for (size_t i = 0; i < count; ++i) {
+		g_game.internalMoveCreature(creatures[creature(generator)], static_cast<Direction>(direction(generator)));
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(spectator_cache)
+
+BOOST_AUTO_TEST_CASE(cached_spectators_follow_every_move)
+{
+	const std::vector<Creature*>& creatures = getDepotCreatures();
+	std::mt19937 generator(0x5EC7A7);
+
+	for (int32_t round = 0; round < 50; ++round) {
+		// fill the cache around everyone, then move a few of them
+		for (Creature* creature : creatures) {
+			getSpectators(creature->getPosition());
+		}
+		moveRandomly(creatures, 5, generator);
+
+		for (Creature* creature : creatures) {
+			const Position& pos = creature->getPosition();
+			BOOST_TEST_CONTEXT("round " << round << ", spectators of " << pos) {
+				BOOST_CHECK(getSpectators(pos) == findSpectators(creatures, pos));
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(spectator_cache)
+
+BOOST_AUTO_TEST_CASE(crowded_depot)
+{
+	const std::vector<Creature*>& creatures = getDepotCreatures();
+	const int32_t ticks = 200;
+
+	// every tick a few creatures walk, then everyone says something and casts an effect
+	for (bool clearEveryTick : {true, false}) {
+		std::mt19937 generator(0xDE9075);
+		g_game.map.clearSpectatorCache();
+		g_game.map.takeSpectatorCacheStats();
+
+		int64_t time = measureTime([&]() {
+			for (int32_t tick = 0; tick < ticks; ++tick) {
+				if (clearEveryTick) {
+					g_game.map.clearSpectatorCache();
+				}
+
+				moveRandomly(creatures, 10, generator);
+				for (Creature* creature : creatures) {
+					for (int32_t broadcast = 0; broadcast < 2; ++broadcast) {
+						SpectatorVec spectators;
+						g_game.map.getSpectators(spectators, creature->getPosition(), true);
+					}
+				}
+			}
+		});
+
+		SpectatorCacheStats stats = g_game.map.takeSpectatorCacheStats();
+		std::cout << "> Crowded depot, " << (clearEveryTick ? "cache cleared every tick" : "cache invalidated per move") << ": "
+		          << stats.hits << " hits, " << stats.misses << " misses (" << std::fixed << std::setprecision(1)
+		          << 100. * stats.hits / std::max<uint64_t>(1, stats.hits + stats.misses) << "%), " << stats.invalidated
+		          << " entries invalidated, " << time / ticks << " us per tick." << std::endl;
+	}
+}
+
+BENCH_SUITE_END()
@@ -0,0 +1,173 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+
+#include <cstdlib>
+#include <unordered_set>
+
+extern Game g_game;
+
+// every allocation of the test run is counted, the benchmarks compare the counts
+static std::atomic<uint64_t> allocations {0};
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace {
+
+// creatures are only compared, never touched
+Creature* getFakeCreature(uintptr_t id)
+{
+	return reinterpret_cast<Creature*>(id * alignof(Creature*) + alignof(Creature*));
+}
+
+std::vector<Creature*> sorted(const SpectatorVec& spectators)
+{
+	std::vector<Creature*> result(spectators.begin(), spectators.end());
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(spectator_vec)
+
+BOOST_AUTO_TEST_CASE(add_spectators_skips_duplicates)
+{
+	// within and past the inline storage, which dedups differently
+	for (uintptr_t count : {10, 30, 100}) {
+		SpectatorVec first;
+		SpectatorVec second;
+		std::vector<Creature*> expected;
+		for (uintptr_t i = 0; i < count; ++i) {
+			first.emplace_back(getFakeCreature(i));
+			second.emplace_back(getFakeCreature(i + count / 2));
+			expected.push_back(getFakeCreature(i));
+		}
+		for (uintptr_t i = count; i < count + count / 2; ++i) {
+			expected.push_back(getFakeCreature(i));
+		}
+
+		first.addSpectators(second);
+		BOOST_TEST_CONTEXT(count << " spectators") {
+			BOOST_CHECK(sorted(first) == expected);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(copies_and_moves_keep_the_spectators)
+{
+	for (uintptr_t count : {static_cast<size_t>(5), SpectatorVec::INLINE_CAPACITY + 5}) {
+		SpectatorVec spectators;
+		for (uintptr_t i = 0; i < count; ++i) {
+			spectators.emplace_back(getFakeCreature(i));
+		}
+		const std::vector<Creature*> expected = sorted(spectators);
+
+		SpectatorVec copy(spectators);
+		SpectatorVec moved(std::move(copy));
+		BOOST_CHECK(copy.empty());
+		BOOST_CHECK(sorted(moved) == expected);
+
+		moved.erase(getFakeCreature(0));
+		BOOST_CHECK_EQUAL(moved.size(), count - 1);
+		BOOST_CHECK(sorted(spectators) == expected);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(spectator_vec)
+
+BOOST_AUTO_TEST_CASE(allocations_per_lookup)
+{
+	// a quiet hunting ground and a crowd, one creature every 16 and every 4 tiles
+	const Position areaFrom(400, 100, 7);
+	const Position areaTo(463, 131, 7);
+	testworld::createArea(areaFrom, areaTo);
+
+	std::mt19937 generator(0xA110C);
+	std::vector<Creature*> creatures;
+	for (int32_t density : {16, 4}) {
+		const Position from(areaFrom.x + (density == 4 ? 32 : 0), areaFrom.y, areaFrom.z);
+		const Position to(from.x + 31, areaTo.y, areaTo.z);
+		for (int32_t i = 0; i < 32 * 32 / density; ++i) {
+			creatures.push_back(testworld::placeMonster(testworld::getFreePosition(from, to, generator)));
+		}
+
+		const uint32_t lookups = 20000;
+		std::uniform_int_distribution<uint16_t> x(from.x, to.x);
+		std::uniform_int_distribution<uint16_t> y(from.y, to.y);
+		std::vector<Position> positions;
+		for (uint32_t i = 0; i < lookups; ++i) {
+			positions.emplace_back(x(generator), y(generator), from.z);
+		}
+
+		// the same uncached lookups, collected into what broadcasts used before and now
+		size_t found = 0;
+		uint64_t allocationsBefore = allocations.load();
+		int64_t hashSetTime = measureTime([&]() {
+			for (const Position& pos : positions) {
+				SpectatorVec spectators;
+				g_game.map.getSpectators(spectators, pos);
+				std::unordered_set<Creature*> hashSet(spectators.begin(), spectators.end());
+				found += hashSet.size();
+			}
+		});
+		uint64_t hashSetAllocations = allocations.load() - allocationsBefore;
+
+		allocationsBefore = allocations.load();
+		int64_t vecTime = measureTime([&]() {
+			for (const Position& pos : positions) {
+				SpectatorVec spectators;
+				g_game.map.getSpectators(spectators, pos);
+			}
+		});
+		uint64_t vecAllocations = allocations.load() - allocationsBefore;
+
+		std::cout << "> " << static_cast<double>(found) / lookups << " spectators per lookup: unordered_set "
+		          << static_cast<double>(hashSetAllocations) / lookups << " allocations and " << hashSetTime * 1000 / lookups
+		          << " ns, SpectatorVec " << static_cast<double>(vecAllocations) / lookups << " allocations and "
+		          << vecTime * 1000 / lookups << " ns per lookup." << std::endl;
+	}
+}
+
+BENCH_SUITE_END()
@@ -0,0 +1,208 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+
+extern Game g_game;
+
+namespace {
+
+const Position AREA_FROM(100, 300, 7);
+const Position AREA_TO(163, 363, 7);
+
+void createWalledArea()
+{
+	static bool created = false;
+	if (!created) {
+		created = true;
+		std::mt19937 generator(0xB17);
+		std::bernoulli_distribution wall(0.2);
+		testworld::createArea(AREA_FROM, AREA_TO, [&](const Position&) { return wall(generator); });
+	}
+}
+
+// the sight line as it was checked before the bitmaps, with a tile lookup per step
+bool checkTileSightLine(const Position& fromPos, const Position& toPos)
+{
+	if (fromPos == toPos) {
+		return true;
+	}
+
+	Position start(fromPos);
+	const Position& destination = toPos;
+
+	const int8_t mx = start.x < destination.x ? 1 : start.x == destination.x ? 0 : -1;
+	const int8_t my = start.y < destination.y ? 1 : start.y == destination.y ? 0 : -1;
+
+	int32_t A = Position::getOffsetY(destination, start);
+	int32_t B = Position::getOffsetX(start, destination);
+	int32_t C = -(A * destination.x + B * destination.y);
+
+	while (start.x != destination.x || start.y != destination.y) {
+		int32_t move_hor = std::abs(A * (start.x + mx) + B * (start.y) + C);
+		int32_t move_ver = std::abs(A * (start.x) + B * (start.y + my) + C);
+		int32_t move_cross = std::abs(A * (start.x + mx) + B * (start.y + my) + C);
+
+		if (start.y != destination.y && (start.x == destination.x || move_hor > move_ver || move_hor > move_cross)) {
+			start.y += my;
+		}
+
+		if (start.x != destination.x && (start.y == destination.y || move_ver > move_hor || move_ver > move_cross)) {
+			start.x += mx;
+		}
+
+		const Tile* tile = g_game.map.getTile(start.x, start.y, start.z);
+		if (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool isTileSightClear(const Position& fromPos, const Position& toPos)
+{
+	return checkTileSightLine(fromPos, toPos) || checkTileSightLine(toPos, fromPos);
+}
+
+// pairs of positions within the range of a distance attack
+std::vector<std::pair<Position, Position>> getSightPairs(size_t count)
+{
+	std::mt19937 generator(0x516B7);
+	std::uniform_int_distribution<uint16_t> x(AREA_FROM.x + Map::maxClientViewportX, AREA_TO.x - Map::maxClientViewportX);
+	std::uniform_int_distribution<uint16_t> y(AREA_FROM.y + Map::maxClientViewportY, AREA_TO.y - Map::maxClientViewportY);
+	std::uniform_int_distribution<int32_t> dx(-Map::maxClientViewportX, Map::maxClientViewportX);
+	std::uniform_int_distribution<int32_t> dy(-Map::maxClientViewportY, Map::maxClientViewportY);
+
+	std::vector<std::pair<Position, Position>> pairs;
+	for (size_t i = 0; i < count; ++i) {
+		Position fromPos(x(generator), y(generator), AREA_FROM.z);
+		pairs.emplace_back(fromPos, Position(fromPos.x + dx(generator), fromPos.y + dy(generator), fromPos.z));
+	}
+	return pairs;
+}
+
+void checkBitmaps(const Position& fromPos, const Position& toPos)
+{
+	for (uint16_t y = fromPos.y; y <= toPos.y; ++y) {
+		for (uint16_t x = fromPos.x; x <= toPos.x; ++x) {
+			const Tile* tile = g_game.map.getTile(x, y, fromPos.z);
+			const bool projectileBlocked = tile && tile->hasFlag(TILESTATE_BLOCKPROJECTILE);
+			const bool pathBlocked = !tile || !tile->getGround() || tile->hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT);
+			BOOST_TEST_CONTEXT("tile on " << Position(x, y, fromPos.z)) {
+				BOOST_CHECK_EQUAL(g_game.map.isProjectileBlocked(x, y, fromPos.z), projectileBlocked);
+				BOOST_CHECK_EQUAL(g_game.map.isPathBlocked(x, y, fromPos.z), pathBlocked);
+			}
+		}
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(tile_bitmaps)
+
+BOOST_AUTO_TEST_CASE(bitmaps_follow_the_tiles)
+{
+	createWalledArea();
+
+	// the margin covers positions without tiles
+	checkBitmaps(Position(AREA_FROM.x - 8, AREA_FROM.y - 8, AREA_FROM.z), Position(AREA_TO.x + 8, AREA_TO.y + 8, AREA_TO.z));
+
+	std::mt19937 generator(0xB17B17);
+	Tile* tile = g_game.map.getTile(testworld::getFreePosition(AREA_FROM, AREA_TO, generator));
+	const Position& pos = tile->getPosition();
+
+	Item* wall = Item::CreateItem(testworld::ITEM_WALL);
+	BOOST_REQUIRE_EQUAL(g_game.internalAddItem(tile, wall, INDEX_WHEREEVER, FLAG_NOLIMIT), RETURNVALUE_NOERROR);
+	BOOST_CHECK(g_game.map.isProjectileBlocked(pos.x, pos.y, pos.z));
+	BOOST_CHECK(g_game.map.isPathBlocked(pos));
+	checkBitmaps(pos, pos);
+
+	BOOST_REQUIRE_EQUAL(g_game.internalRemoveItem(wall), RETURNVALUE_NOERROR);
+	BOOST_CHECK(!g_game.map.isProjectileBlocked(pos.x, pos.y, pos.z));
+	BOOST_CHECK(!g_game.map.isPathBlocked(pos));
+}
+
+BOOST_AUTO_TEST_CASE(sight_matches_the_tile_scan)
+{
+	createWalledArea();
+
+	for (const auto& pair : getSightPairs(20000)) {
+		if (g_game.map.isSightClear(pair.first, pair.second, true) != isTileSightClear(pair.first, pair.second)) {
+			BOOST_ERROR("sight differs from " << pair.first << " to " << pair.second);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(tile_bitmaps)
+
+BOOST_AUTO_TEST_CASE(sight_and_paths)
+{
+	createWalledArea();
+
+	const std::vector<std::pair<Position, Position>> pairs = getSightPairs(200000);
+	size_t clear = 0;
+	int64_t tileTime = measureTime([&]() {
+		for (const auto& pair : pairs) {
+			clear += isTileSightClear(pair.first, pair.second);
+		}
+	});
+	int64_t bitmapTime = measureTime([&]() {
+		for (const auto& pair : pairs) {
+			clear += g_game.map.isSightClear(pair.first, pair.second, true);
+		}
+	});
+	std::cout << "> isSightClear: " << tileTime * 1000 / pairs.size() << " ns per check with tile lookups, "
+	          << bitmapTime * 1000 / pairs.size() << " ns with the bitmaps, " << clear / 2 << " of " << pairs.size() << " clear." << std::endl;
+
+	// a monster chasing targets around the walls from random spots
+	std::mt19937 generator(0xB17);
+	Monster* monster = testworld::placeMonster(testworld::getFreePosition(AREA_FROM, AREA_TO, generator));
+
+	FindPathParams fpp;
+	fpp.fullPathSearch = true;
+	fpp.maxSearchDist = 12;
+	fpp.minTargetDist = 1;
+	fpp.maxTargetDist = 1;
+
+	size_t searches = 0;
+	size_t found = 0;
+	int64_t pathTime = 0;
+	for (size_t i = 0; i < 2000; ++i) {
+		const Position& startPos = pairs[i].first;
+		if (g_game.internalTeleport(monster, startPos) != RETURNVALUE_NOERROR) {
+			continue;
+		}
+
+		++searches;
+		pathTime += measureTime([&]() {
+			std::forward_list<Direction> dirList;
+			found += g_game.map.getPathMatching(*monster, dirList, FrozenPathingConditionCall(pairs[i].second), fpp);
+		});
+	}
+	std::cout << "> getPathMatching: " << pathTime / std::max<size_t>(1, searches) << " us per search, " << found << " of " << searches << " found." << std::endl;
+}
+
+BENCH_SUITE_END()
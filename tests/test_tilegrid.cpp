@@ -0,0 +1,139 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+
+extern Game g_game;
+
+namespace {
+
+const Position GRID_FROM(512, 512, 7);
+const Position GRID_TO(767, 767, 7);
+// past the map size of the test world, only the QTree knows these
+const Position OUTSIDE_FROM(testworld::MAP_SIZE + 64, 100, 7);
+const Position OUTSIDE_TO(testworld::MAP_SIZE + 95, 131, 7);
+
+struct MapAccess : Map {
+	static const QTreeNode& getRoot(const Map& map) {
+		return map.*(&MapAccess::root);
+	}
+};
+
+// the lookup the tile grid replaced, all the way down the QTree
+Tile* getQTreeTile(uint16_t x, uint16_t y, uint8_t z)
+{
+	const QTreeLeafNode* leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&MapAccess::getRoot(g_game.map), x, y);
+	if (!leaf) {
+		return nullptr;
+	}
+
+	const Floor* floor = leaf->getFloor(z);
+	if (!floor) {
+		return nullptr;
+	}
+	return floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
+}
+
+void createGridArea()
+{
+	static bool created = false;
+	if (!created) {
+		created = true;
+		testworld::createArea(GRID_FROM, GRID_TO);
+		testworld::createArea(OUTSIDE_FROM, OUTSIDE_TO);
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(tile_grid)
+
+BOOST_AUTO_TEST_CASE(grid_and_qtree_find_the_same_tiles)
+{
+	createGridArea();
+
+	// a margin around both areas covers the leaves and chunks without tiles too
+	for (const auto& area : {std::make_pair(GRID_FROM, GRID_TO), std::make_pair(OUTSIDE_FROM, OUTSIDE_TO)}) {
+		for (int32_t y = area.first.y - 40; y <= area.second.y + 40; ++y) {
+			for (int32_t x = area.first.x - 40; x <= area.second.x + 40; ++x) {
+				for (uint8_t z : {6, 7}) {
+					Tile* tile = g_game.map.getTile(x, y, z);
+					if (tile != getQTreeTile(x, y, z)) {
+						BOOST_ERROR("tiles differ on " << Position(x, y, z));
+					}
+				}
+			}
+		}
+	}
+
+	BOOST_CHECK(g_game.map.getTile(GRID_FROM) != nullptr);
+	BOOST_CHECK(g_game.map.getTile(OUTSIDE_TO) != nullptr);
+	BOOST_CHECK(g_game.map.getTile(GRID_FROM.x, GRID_FROM.y, 6) == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(tile_grid)
+
+BOOST_AUTO_TEST_CASE(lookups)
+{
+	createGridArea();
+
+	std::mt19937 generator(0x6121D);
+	std::uniform_int_distribution<uint16_t> x(GRID_FROM.x + 1, GRID_TO.x - 1);
+	std::uniform_int_distribution<uint16_t> y(GRID_FROM.y + 1, GRID_TO.y - 1);
+	std::vector<Position> positions;
+	for (int32_t i = 0; i < 1000000; ++i) {
+		positions.emplace_back(x(generator), y(generator), GRID_FROM.z);
+	}
+
+	auto getGridTile = [](uint16_t x, uint16_t y, uint8_t z) { return g_game.map.getTile(x, y, z); };
+	auto benchmark = [&](const char* name, Tile* (*getTile)(uint16_t, uint16_t, uint8_t)) {
+		// random lookups all over the area, then the neighbours of a tile like a path search reads them
+		uintptr_t checksum = 0;
+		int64_t randomTime = measureTime([&]() {
+			for (const Position& pos : positions) {
+				checksum += reinterpret_cast<uintptr_t>(getTile(pos.x, pos.y, pos.z));
+			}
+		});
+		int64_t neighbourTime = measureTime([&]() {
+			for (size_t i = 0; i < positions.size(); i += 9) {
+				const Position& pos = positions[i];
+				for (int32_t dy = -1; dy <= 1; ++dy) {
+					for (int32_t dx = -1; dx <= 1; ++dx) {
+						checksum += reinterpret_cast<uintptr_t>(getTile(pos.x + dx, pos.y + dy, pos.z));
+					}
+				}
+			}
+		});
+
+		std::cout << "> " << name << ": " << randomTime * 1000 / positions.size() << " ns per random lookup, "
+		          << neighbourTime * 1000 / positions.size() << " ns per neighbour lookup (checksum " << (checksum & 0xFFFF) << ")." << std::endl;
+	};
+
+	benchmark("QTree", getQTreeTile);
+	benchmark("Tile grid", getGridTile);
+}
+
+BENCH_SUITE_END()
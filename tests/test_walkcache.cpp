@@ -0,0 +1,194 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "testworld.h"
+#include "bench.h"
+#include "condition.h"
+
+extern Game g_game;
+
+namespace {
+
+const Position AREA_FROM(600, 100, 7);
+const Position AREA_TO(639, 139, 7);
+constexpr uint16_t ITEM_FIREFIELD = 1487;
+
+size_t tileQueries = 0;
+
+// counts the queries the walk caches make
+class CountingTile final : public DynamicTile
+{
+	public:
+		using DynamicTile::DynamicTile;
+
+		ReturnValue queryAdd(int32_t index, const Thing& thing, uint32_t count, uint32_t flags, Creature* actor = nullptr) const override {
+			++tileQueries;
+			return DynamicTile::queryAdd(index, thing, count, flags, actor);
+		}
+};
+
+struct CreatureAccess : Creature {
+	// what a fire, energy or poison condition used to cost a monster
+	static void rebuildMapCache(Creature& creature) {
+		(creature.*(&CreatureAccess::updateMapCache))();
+	}
+};
+
+// walls and fire fields over a third of the area each
+void createBurningArea()
+{
+	static bool created = false;
+	if (!created) {
+		created = true;
+		testworld::load();
+
+		std::mt19937 generator(0xF14E);
+		std::discrete_distribution<int32_t> content({2, 1, 1});
+		for (uint16_t y = AREA_FROM.y; y <= AREA_TO.y; ++y) {
+			for (uint16_t x = AREA_FROM.x; x <= AREA_TO.x; ++x) {
+				int32_t type = content(generator);
+				Tile* tile = new CountingTile(x, y, AREA_FROM.z);
+				testworld::placeTile(tile, type == 1);
+				if (type == 2) {
+					tile->internalAddThing(Item::CreateItem(ITEM_FIREFIELD));
+				}
+			}
+		}
+	}
+}
+
+std::vector<Monster*> placeHorde(size_t count, std::mt19937& generator)
+{
+	std::vector<Monster*> horde;
+	for (size_t i = 0; i < count; ++i) {
+		horde.push_back(testworld::placeMonster(testworld::getFreePosition(AREA_FROM, AREA_TO, generator)));
+	}
+	return horde;
+}
+
+// a burning that deals its damage only with the first tick, ten seconds later
+Condition* createBurning()
+{
+	ConditionDamage* condition = static_cast<ConditionDamage*>(Condition::createCondition(CONDITIONID_COMBAT, CONDITION_FIRE, 0));
+	condition->setParam(CONDITION_PARAM_DELAYED, 1);
+	condition->addDamage(1, 10000, -10);
+	return condition;
+}
+
+void toggleBurning(Monster* monster)
+{
+	if (monster->hasCondition(CONDITION_FIRE)) {
+		monster->removeCondition(CONDITION_FIRE);
+	} else {
+		BOOST_REQUIRE(monster->addCondition(createBurning()));
+	}
+}
+
+// the walk cache as it was, a tile query per position
+void checkWalkCache(const Monster& monster)
+{
+	const Position& myPos = monster.getPosition();
+	for (int32_t dy = -Map::maxViewportY; dy <= Map::maxViewportY; ++dy) {
+		for (int32_t dx = -Map::maxViewportX; dx <= Map::maxViewportX; ++dx) {
+			if (dx == 0 && dy == 0) {
+				continue;
+			}
+
+			Position pos(myPos.x + dx, myPos.y + dy, myPos.z);
+			const Tile* tile = g_game.map.getTile(pos);
+			const bool walkable = tile && !g_game.map.isPathBlocked(pos) && tile->queryAdd(0, monster, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) == RETURNVALUE_NOERROR;
+			BOOST_TEST_CONTEXT("walk cache of " << myPos << " on " << pos) {
+				BOOST_CHECK_EQUAL(monster.getWalkCache(pos), walkable ? 1 : 0);
+			}
+		}
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(walk_cache)
+
+BOOST_AUTO_TEST_CASE(walk_cache_follows_burning_and_steps)
+{
+	createBurningArea();
+
+	std::mt19937 generator(0xF14E);
+	std::vector<Monster*> horde = placeHorde(20, generator);
+	std::uniform_int_distribution<int32_t> direction(DIRECTION_NORTH, DIRECTION_NORTHEAST);
+	std::bernoulli_distribution burn(0.3);
+	for (size_t round = 0; round < 20; ++round) {
+		for (Monster* monster : horde) {
+			if (burn(generator)) {
+				toggleBurning(monster);
+			}
+
+			g_game.internalMoveCreature(monster, static_cast<Direction>(direction(generator)), FLAG_IGNOREFIELDDAMAGE | FLAG_NOLIMIT);
+		}
+
+		for (Monster* monster : horde) {
+			checkWalkCache(*monster);
+		}
+	}
+
+	for (Monster* monster : horde) {
+		g_game.removeCreature(monster);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(walk_cache)
+
+BOOST_AUTO_TEST_CASE(horde_in_fire)
+{
+	createBurningArea();
+
+	std::mt19937 generator(0xF14E);
+	std::vector<Monster*> horde = placeHorde(100, generator);
+
+	// every monster catches fire and has it put out, over and over
+	for (bool rebuild : {true, false}) {
+		const size_t queries = tileQueries;
+		size_t changes = 0;
+		int64_t time = measureTime([&]() {
+			for (size_t round = 0; round < 50; ++round) {
+				for (Monster* monster : horde) {
+					toggleBurning(monster);
+					if (rebuild) {
+						CreatureAccess::rebuildMapCache(*monster);
+					}
+					++changes;
+				}
+			}
+		});
+		std::cout << "> " << horde.size() << " monsters in fire, " << (rebuild ? "walk cache rebuilt on each condition change" : "field layers") << ": "
+		          << (tileQueries - queries) / changes << " tile queries and " << time * 1000 / changes << " ns per change, "
+		          << (tileQueries - queries) * 1000000 / std::max<int64_t>(1, time) << " queries per second." << std::endl;
+	}
+
+	for (Monster* monster : horde) {
+		g_game.removeCreature(monster);
+	}
+}
+
+BENCH_SUITE_END()
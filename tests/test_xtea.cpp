@@ -0,0 +1,129 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include "xtea.h"
+#include "bench.h"
+
+#include <random>
+
+namespace {
+
+// textbook XTEA on little-endian words, independent from the key schedule in xtea.cpp
+void referenceEncrypt(uint8_t* data, size_t length, const xtea::key& k)
+{
+	for (size_t pos = 0; pos < length; pos += 8) {
+		uint32_t v0, v1;
+		memcpy(&v0, data + pos, 4);
+		memcpy(&v1, data + pos + 4, 4);
+
+		uint32_t sum = 0;
+		for (int32_t i = 0; i < 32; ++i) {
+			v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + k[sum & 3]);
+			sum += 0x9E3779B9;
+			v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + k[(sum >> 11) & 3]);
+		}
+
+		memcpy(data + pos, &v0, 4);
+		memcpy(data + pos + 4, &v1, 4);
+	}
+}
+
+std::vector<xtea::Kernel> getSupportedKernels()
+{
+	std::vector<xtea::Kernel> kernels;
+	for (uint8_t kernel = xtea::KERNEL_SCALAR; kernel <= xtea::getKernel(); ++kernel) {
+		kernels.push_back(static_cast<xtea::Kernel>(kernel));
+	}
+	return kernels;
+}
+
+std::vector<uint8_t> randomBytes(std::mt19937& generator, size_t length)
+{
+	std::uniform_int_distribution<uint32_t> byte(0, 0xFF);
+	std::vector<uint8_t> data(length);
+	for (uint8_t& value : data) {
+		value = byte(generator);
+	}
+	return data;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(xtea_kernels)
+
+BOOST_AUTO_TEST_CASE(every_kernel_matches_the_reference)
+{
+	std::mt19937 generator(0x5EED);
+	std::uniform_int_distribution<uint32_t> word;
+	std::uniform_int_distribution<size_t> blockCount(70, 1000);
+
+	for (uint32_t round = 0; round < 200; ++round) {
+		xtea::key key {{word(generator), word(generator), word(generator), word(generator)}};
+		xtea::round_keys roundKeys = xtea::expandKey(key);
+
+		// every tail the 4 and 8 block kernels can leave, then random lengths
+		size_t blocks = round < 70 ? round : blockCount(generator);
+		std::vector<uint8_t> plain = randomBytes(generator, blocks * 8);
+
+		std::vector<uint8_t> expected = plain;
+		referenceEncrypt(expected.data(), expected.size(), key);
+
+		for (xtea::Kernel kernel : getSupportedKernels()) {
+			BOOST_TEST_CONTEXT("kernel " << xtea::getKernelName(kernel) << ", " << blocks << " blocks") {
+				std::vector<uint8_t> data = plain;
+				xtea::encrypt(data.data(), data.size(), roundKeys, kernel);
+				BOOST_CHECK(data == expected);
+
+				xtea::decrypt(data.data(), data.size(), roundKeys, kernel);
+				BOOST_CHECK(data == plain);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BENCH_SUITE(xtea_kernels)
+
+BOOST_AUTO_TEST_CASE(throughput)
+{
+	std::mt19937 generator(0x5EED);
+	xtea::round_keys roundKeys = xtea::expandKey({{0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210}});
+
+	// a full output message worth of blocks
+	std::vector<uint8_t> data = randomBytes(generator, 24584);
+	const uint32_t iterations = 2000;
+
+	for (xtea::Kernel kernel : getSupportedKernels()) {
+		int64_t time = measureTime([&]() {
+			for (uint32_t i = 0; i < iterations; ++i) {
+				xtea::encrypt(data.data(), data.size(), roundKeys, kernel);
+				xtea::decrypt(data.data(), data.size(), roundKeys, kernel);
+			}
+		});
+		std::cout << "> XTEA " << xtea::getKernelName(kernel) << ": " << (2. * iterations * data.size()) / std::max<int64_t>(1, time)
+		          << " MB/s." << std::endl;
+	}
+}
+
+BENCH_SUITE_END()
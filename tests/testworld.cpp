@@ -0,0 +1,124 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "testworld.h"
+
+#include "configmanager.h"
+#include "movement.h"
+
+extern ConfigManager g_config;
+extern MoveEvents* g_moveEvents;
+
+namespace {
+
+// the map size is only known to the map loader, so it is set the way IOMap would
+struct MapAccess : Map {
+	static void setSize(Map& map, uint32_t width, uint32_t height) {
+		map.*(&MapAccess::width) = width;
+		map.*(&MapAccess::height) = height;
+	}
+};
+
+MonsterType& getMonsterType()
+{
+	static MonsterType monsterType;
+	if (monsterType.name.empty()) {
+		monsterType.name = "Test Monster";
+		monsterType.nameDescription = "a test monster";
+	}
+	return monsterType;
+}
+
+}
+
+namespace testworld {
+
+void load()
+{
+	static bool loaded = false;
+	if (loaded) {
+		return;
+	}
+	loaded = true;
+
+	if (!g_config.load()) {
+		throw std::runtime_error("unable to load config.lua, run the tests from the source directory");
+	}
+
+	if (Item::items.loadFromOtb("data/items/items.otb") != ERROR_NONE || !Item::items.loadFromXml()) {
+		throw std::runtime_error("unable to load the items");
+	}
+
+	// no move events are loaded, the tiles only need someone to ask
+	g_moveEvents = new MoveEvents();
+
+	MapAccess::setSize(g_game.map, MAP_SIZE, MAP_SIZE);
+}
+
+void placeTile(Tile* tile, bool wall/* = false*/)
+{
+	tile->internalAddThing(Item::CreateItem(ITEM_GRASS));
+	if (wall) {
+		tile->internalAddThing(Item::CreateItem(ITEM_WALL));
+	}
+	g_game.map.setTile(tile->getPosition(), tile);
+}
+
+void createArea(const Position& fromPos, const Position& toPos, const std::function<bool(const Position&)>& isWall/* = nullptr*/)
+{
+	load();
+
+	for (uint16_t y = fromPos.y; y <= toPos.y; ++y) {
+		for (uint16_t x = fromPos.x; x <= toPos.x; ++x) {
+			Position pos(x, y, fromPos.z);
+			placeTile(new DynamicTile(x, y, pos.z), isWall && isWall(pos));
+		}
+	}
+}
+
+Monster* placeMonster(const Position& pos, Creature* master/* = nullptr*/)
+{
+	Monster* monster = new Monster(&getMonsterType());
+	if (master) {
+		monster->setMaster(master);
+	}
+
+	if (!g_game.placeCreature(monster, pos, false, true)) {
+		delete monster;
+		throw std::runtime_error("unable to place a monster");
+	}
+	return monster;
+}
+
+Position getFreePosition(const Position& fromPos, const Position& toPos, std::mt19937& generator)
+{
+	std::uniform_int_distribution<uint16_t> x(fromPos.x, toPos.x);
+	std::uniform_int_distribution<uint16_t> y(fromPos.y, toPos.y);
+	while (true) {
+		Position pos(x(generator), y(generator), fromPos.z);
+		const Tile* tile = g_game.map.getTile(pos);
+		if (tile && !tile->hasProperty(CONST_PROP_BLOCKSOLID) && !tile->getTopCreature()) {
+			return pos;
+		}
+	}
+}
+
+}
@@ -0,0 +1,56 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2017  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_TESTWORLD_H_6D0B2E8F4A1C4B7E9F3A5C2D1E0B7A64
+#define FS_TESTWORLD_H_6D0B2E8F4A1C4B7E9F3A5C2D1E0B7A64
+
+#include "game.h"
+#include "monster.h"
+
+#include <functional>
+#include <random>
+
+/**
+  * Builds small worlds on g_game.map for the tests. Every test gets a box of
+  * its own on the map and leaves it as it is, the process ends afterwards.
+  */
+namespace testworld {
+
+static constexpr uint16_t ITEM_GRASS = 106;
+static constexpr uint16_t ITEM_WALL = 1026;
+static constexpr uint32_t MAP_SIZE = 1024;
+
+// loads the config, the items and the move events the first time it is called
+void load();
+
+// adds grass and, if asked for, a wall to tile and puts it on the map
+void placeTile(Tile* tile, bool wall = false);
+
+// a box of grass tiles with walls where isWall returns true, the box must not hold any tiles yet
+void createArea(const Position& fromPos, const Position& toPos, const std::function<bool(const Position&)>& isWall = nullptr);
+
+// a melee monster without scripts or loot, placed on pos like a spawn would
+Monster* placeMonster(const Position& pos, Creature* master = nullptr);
+
+// a random free position in the box, that is one without a wall or a creature
+Position getFreePosition(const Position& fromPos, const Position& toPos, std::mt19937& generator);
+
+}
+
+#endif